@@ -222,7 +222,7 @@
 
 #define TFT_MOSI 11 // In some display driver board, it might be written as "SDA" and so on.
 #define TFT_SCLK 12
-#define TFT_CS   10  // Chip select control pin
+#define TFT_CS   -1  // Chip select control pin: none, DisplayScheduler drives both panels' CS (GPIO 10 and 2)
 #define TFT_DC   9  // Data Command control pin
 #define TFT_RST  8 // Reset pin (could connect to Arduino RESET pin)
 //#define TFT_BL   22  // LED back-light
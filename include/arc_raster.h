@@ -0,0 +1,174 @@
+#pragma once
+#include <stdint.h>
+#include <sprite_spans.h>
+#include <trig_utils.h>
+
+// Scanline rasterizer for the thick, flared boost arc on screen 0.
+//
+// The arc hangs below the centre and opens symmetrically to both sides by
+// `sweep` degrees. Its inner radius grows linearly from innerR to innerR + flare
+// over the sweep, and its colour is picked per whole degree from `bands`.
+// Each row is cut into spans directly: a degree covers the pixels between the
+// row's crossings with its two half-degree rays, and the arc within it the
+// pixels between the crossings with that degree's inner and outer circles, so
+// a row costs a few hspan() calls, never a step per pixel. Ray crossings come
+// from a per-degree Q16 slope and one multiply. Rows are drawn bottom up, where
+// every circle crossing only moves outwards, so each is carried from the row
+// below and nudged out by a pixel or two, with no square roots. The result has
+// no holes.
+
+const int ARC_MAX_SWEEP = 90;
+
+struct ArcBand {
+  int16_t untilDeg; // band covers degrees below this value
+  uint8_t color;    // 8-bit sprite colour
+};
+
+struct FlaredArc {
+  int16_t cx, cy;
+  int16_t innerR;    // inner radius at 0 degrees
+  int16_t thickness; // radial thickness in pixels
+  int16_t sweep;     // degrees each side of straight down
+  int16_t flare;     // extra radius reached at the end of the sweep
+  int16_t leftTip;   // extra outer radius on the last two degrees of the left side
+  const ArcBand *bands;
+  uint8_t bandCount; // degrees past the last band are not drawn
+};
+
+namespace arc_detail {
+
+const uint8_t NO_COLOR = 0;
+
+struct SideTable {
+  int32_t in2[ARC_MAX_SWEEP + 1];  // squared inner radius per degree (Q8, doubled units)
+  int32_t out2[ARC_MAX_SWEEP + 1]; // squared outer radius per degree
+  int32_t rayCos[ARC_MAX_SWEEP + 1]; // Q15 ray at k + 0.5 degrees from straight down, ending degree k
+  int32_t raySin[ARC_MAX_SWEEP + 1];
+  int32_t raySlope[ARC_MAX_SWEEP + 1]; // Q16 sin / cos, rounded down
+  uint8_t color[ARC_MAX_SWEEP + 1];
+  bool draw[ARC_MAX_SWEEP + 1];
+  int32_t minIn2, maxOut2;
+  // carried from row to row: the first degree reaching the row's inner edge,
+  // the row's crossings with the innermost and outermost circles, and each
+  // degree's last inner and outer crossing found
+  int k;
+  int32_t innerX, outerX;
+  int32_t inX[ARC_MAX_SWEEP + 1];
+  int32_t outX[ARC_MAX_SWEEP + 1];
+};
+
+inline void buildSide(const FlaredArc &arc, int16_t tip, SideTable &t) {
+  t.minIn2 = INT32_MAX;
+  t.maxOut2 = 0;
+  for (int k = 0; k <= arc.sweep; k++) {
+    // radii in Q4 and doubled, because pixel centres sit on odd half-pixels
+    int32_t rin = (arc.innerR << 4) + (arc.sweep > 0 ? (k * arc.flare * 16) / arc.sweep : 0);
+    int32_t rout = rin + (arc.thickness << 4) + (k >= arc.sweep - 1 ? tip << 4 : 0);
+    t.in2[k] = (2 * rin) * (2 * rin);
+    t.out2[k] = (2 * rout) * (2 * rout);
+    if (t.in2[k] < t.minIn2) t.minIn2 = t.in2[k];
+    if (t.out2[k] > t.maxOut2) t.maxOut2 = t.out2[k];
+    t.rayCos[k] = trig::cosQ15Steps(k * trig::STEPS_PER_DEG + trig::STEPS_PER_DEG / 2);
+    t.raySin[k] = trig::sinQ15Steps(k * trig::STEPS_PER_DEG + trig::STEPS_PER_DEG / 2);
+    t.raySlope[k] = t.rayCos[k] > 0 ? (int32_t)(((int64_t)t.raySin[k] << 16) / t.rayCos[k]) : INT32_MAX;
+    t.draw[k] = false;
+    for (int b = 0; b < arc.bandCount; b++) {
+      if (k < arc.bands[b].untilDeg) {
+        t.color[k] = arc.bands[b].color;
+        t.draw[k] = true;
+        break;
+      }
+    }
+    t.inX[k] = t.outX[k] = 0;
+  }
+  t.k = 0;
+  t.innerX = t.outerX = 0;
+}
+
+// In doubled units (pixel centre at X = 2 * dx + 1), row Y: the first X at or
+// past ray k, i.e. with X * cos >= Y * sin; rays at or past 90 degrees never
+// reach the row. The slope lands on X or a step or two short of it.
+inline int32_t rayCrossing(const SideTable &t, int k, int32_t Y) {
+  if (t.rayCos[k] <= 0) return INT32_MAX;
+  int32_t x = (int32_t)(((int64_t)Y * t.raySlope[k]) >> 16);
+  while (x * t.rayCos[k] < Y * t.raySin[k]) x++;
+  return x;
+}
+
+// The first X at or past x on or outside the circle of squared radius r2 (as
+// in the side table), i.e. with (X^2 + Y^2) << 8 >= r2. Started from a point
+// known to be inside, such as the crossing on a row below, it is the crossing.
+inline int32_t circleCrossing(int32_t r2, int32_t Y, int32_t x) {
+  while ((x * x + Y * Y) << 8 < r2) x++;
+  return x;
+}
+
+// One row of one side, dy below the centre. dir is +1 for the right half, -1
+// for the left.
+inline void rasterRow(SpanTarget &dst, const FlaredArc &arc, SideTable &t, int dy, int dir) {
+  const int32_t Y = 2 * dy + 1;
+  const int32_t innerX = t.innerX = circleCrossing(t.minIn2, Y, t.innerX);
+  const int32_t outerX = t.outerX = circleCrossing(t.maxOut2, Y, t.outerX);
+  if (innerX >= outerX) return;
+  int k = t.k;
+  while (k <= arc.sweep && innerX * t.rayCos[k] >= Y * t.raySin[k]) k++;
+  t.k = k;
+
+  const int y = arc.cy + dy;
+  int32_t runStart = 0, runEnd = 0; // doubled X, end exclusive
+  uint8_t runColor = NO_COLOR;
+  auto flush = [&] {
+    // pixels dx = runStart / 2 .. runEnd / 2 - 1
+    const int x0 = runStart / 2, x1 = runEnd / 2 - 1;
+    if (x1 < x0) return;
+    if (dir > 0) dst.hspan(y, arc.cx + x0, arc.cx + x1, runColor);
+    else dst.hspan(y, arc.cx - x1 - 1, arc.cx - x0 - 1, runColor);
+  };
+
+  int32_t lo = k > 0 ? rayCrossing(t, k - 1, Y) : 0;
+  for (int d = k; d <= arc.sweep && lo < outerX; d++) {
+    const int32_t hi = rayCrossing(t, d, Y);
+    if (t.draw[d] && hi > lo) {
+      // the degree's wedge lo..hi against its ring; a circle is only solved
+      // for where it cuts the wedge, from lo or its crossing a row below,
+      // whichever is further out. Past outerX the wedge is outside every
+      // circle, which also keeps the squares in range.
+      int32_t a = lo, b = hi;
+      if ((lo * lo + Y * Y) << 8 < t.in2[d]) {
+        a = t.inX[d] = circleCrossing(t.in2[d], Y, t.inX[d] > lo ? t.inX[d] : lo);
+      }
+      if (b > outerX || ((b - 1) * (b - 1) + Y * Y) << 8 >= t.out2[d]) {
+        // lo itself outside leaves the wedge empty, and is no crossing to keep
+        const int32_t out = circleCrossing(t.out2[d], Y, t.outX[d] > lo ? t.outX[d] : lo);
+        if (out > lo) t.outX[d] = out;
+        if (out < b) b = out;
+      }
+      if (a < b) {
+        if (a == runEnd && t.color[d] == runColor) runEnd = b;
+        else {
+          if (runEnd > runStart) flush();
+          runStart = a;
+          runEnd = b;
+          runColor = t.color[d];
+        }
+      }
+    }
+    lo = hi;
+  }
+  if (runEnd > runStart) flush();
+}
+
+} // namespace arc_detail
+
+inline void drawFlaredArc(SpanTarget &dst, const FlaredArc &arc) {
+  if (arc.sweep < 0 || arc.sweep > ARC_MAX_SWEEP) return;
+  arc_detail::SideTable right, left;
+  arc_detail::buildSide(arc, 0, right);
+  arc_detail::buildSide(arc, arc.leftTip, left);
+
+  const int maxR = arc.innerR + arc.thickness + arc.flare + arc.leftTip + 1;
+  for (int dy = maxR; dy >= 0; dy--) {
+    arc_detail::rasterRow(dst, arc, right, dy, 1);
+    arc_detail::rasterRow(dst, arc, left, dy, -1);
+  }
+}
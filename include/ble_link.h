@@ -0,0 +1,271 @@
+#pragma once
+#include <stdint.h>
+#include <spsc_ring.h>
+
+// Connection to the scooter controller as a state machine that never blocks:
+//
+//   IDLE -> SCANNING -> CONNECTING -> DISCOVERING -> SUBSCRIBED
+//              ^             |              |             |
+//              +-- BACKOFF <-+--------------+-------------+
+//                      (failure, timeout or link loss)
+//
+// The BLE stack reports what happened by post()ing events from its callback
+// task (the ring's one producer). tick(), called from loop() every pass,
+// handles the events and timeouts and asks the stack for the next step through
+// BleStack, whose calls all return at once, so the displays keep their frame
+// rate through a reconnect. Retries back off exponentially from BACKOFF_MIN_MS
+// to BACKOFF_MAX_MS, back to the minimum once subscribed.
+// Once a controller is known (connected to before, or loaded from flash with
+// setKnownPeer()) every attempt starts by connecting to its address directly,
+// which takes one advertising interval instead of a scan, and only scans if
+// that fails, e.g. because the controller changed its address. A link that
+// drops once subscribed is retried that way at once, without a backoff.
+
+struct BleAddress {
+  uint8_t val[6];
+  uint8_t type; // public / random, as the stack reports it
+};
+
+enum BleEventType : uint8_t {
+  BLE_FOUND,          // scan saw a connectable device advertising the service, addr set
+  BLE_SCAN_END,       // scan ran its full duration
+  BLE_CONNECTED,
+  BLE_CONNECT_FAILED,
+  BLE_DISCONNECTED,
+};
+
+struct BleEvent {
+  BleEventType type;
+  BleAddress addr;
+};
+
+enum BleSetup : uint8_t { BLE_SETUP_BUSY, BLE_SETUP_OK, BLE_SETUP_FAILED };
+
+// What BleLink drives. Every call must return without waiting on the radio;
+// results come back as events, or through setupState() for setup().
+class BleStack {
+public:
+  virtual ~BleStack() {}
+  virtual bool startScan(uint32_t durationMs) = 0;
+  virtual void stopScan() = 0;
+  // Give up with CONNECT_FAILED if the peer isn't heard within timeoutMs
+  virtual bool connect(const BleAddress &peer, uint32_t timeoutMs) = 0;
+  // Find the characteristic and subscribe to it, off the calling task
+  virtual bool setup() = 0;
+  virtual BleSetup setupState() = 0;
+  // Drop the link or abandon a pending connect; DISCONNECTED follows if it was up
+  virtual void disconnect() = 0;
+  // Free what the last connection allocated (remote attributes), called once
+  // for every DISCONNECTED; the client itself is kept for the next connection
+  virtual void release() = 0;
+};
+
+enum BleState : uint8_t { BLE_IDLE, BLE_SCANNING, BLE_CONNECTING, BLE_DISCOVERING, BLE_SUBSCRIBED, BLE_BACKOFF };
+
+class BleLink {
+public:
+  static const uint32_t SCAN_MS = 5000;
+  static const uint32_t CONNECT_MS = 4000;        // to a device the scan just heard
+  static const uint32_t DIRECT_CONNECT_MS = 1500; // to the known peer, a dozen advertising intervals
+  static const uint32_t CONNECT_GRACE_MS = 1000;  // past the stack's timeout before giving up on it
+  static const uint32_t SETUP_TIMEOUT_MS = 5000;
+  static const uint32_t BACKOFF_MIN_MS = 500;
+  static const uint32_t BACKOFF_MAX_MS = 30000;
+
+  typedef void (*PeerFn)(const BleAddress &peer);
+
+  // Controller to try first, e.g. the one saved at the last connection
+  void setKnownPeer(const BleAddress &peer) {
+    _known = peer;
+    _hasKnown = true;
+  }
+  // Called when subscribed to a controller other than the known one, to save it
+  void onNewPeer(PeerFn fn) { _onNewPeer = fn; }
+
+  // Start looking for the controller
+  void begin(BleStack *stack, uint32_t now) {
+    _stack = stack;
+    _downSince = now;
+    attempt(now);
+  }
+
+  // From the stack's callback task only; false if the queue was full
+  bool post(const BleEvent &e) { return _events.push(e); }
+  bool post(BleEventType type) {
+    BleEvent e = {};
+    e.type = type;
+    return _events.push(e);
+  }
+
+  // From loop(): handle queued events and expired timers
+  void tick(uint32_t now) {
+    BleEvent e;
+    while (_events.pop(e)) handle(e, now);
+    const uint32_t elapsed = now - _since;
+    switch (_state) {
+    case BLE_SCANNING:
+      if (elapsed > SCAN_MS + 1000) fail(now); // scan end never reported
+      break;
+    case BLE_CONNECTING:
+      if (elapsed > _connectMs + CONNECT_GRACE_MS) {
+        _stack->disconnect();
+        connectFailed(now);
+      }
+      break;
+    case BLE_DISCOVERING: {
+      const BleSetup s = _stack->setupState();
+      if (s == BLE_SETUP_OK) {
+        enter(BLE_SUBSCRIBED, now);
+        _backoffMs = BACKOFF_MIN_MS;
+        _lastReconnectMs = now - _downSince;
+        _connects++;
+        if (!_hasKnown || !samePeer(_known, _peer)) {
+          setKnownPeer(_peer);
+          if (_onNewPeer) _onNewPeer(_peer);
+        }
+      } else if (s == BLE_SETUP_FAILED || elapsed > SETUP_TIMEOUT_MS) {
+        dropLink();
+        fail(now);
+      }
+      break;
+    }
+    case BLE_BACKOFF:
+      if (elapsed >= _waitMs) attempt(now);
+      break;
+    default:
+      break;
+    }
+  }
+
+  BleState state() const { return _state; }
+  bool subscribed() const { return _state == BLE_SUBSCRIBED; }
+  const BleAddress &peer() const { return _peer; }
+  // Whether the current (or last) connection went straight to the known peer
+  bool direct() const { return _direct; }
+  // Successful connections, failed attempts and link losses, and how long the
+  // last reconnect took from losing (or never having) the link to subscribed
+  uint32_t connects() const { return _connects; }
+  uint32_t failures() const { return _failures; }
+  uint32_t lastReconnectMs() const { return _lastReconnectMs; }
+  // Wait before the next attempt, while in BACKOFF
+  uint32_t backoffMs() const { return _waitMs; }
+
+  static const char *stateName(BleState s) {
+    static const char *const names[] = { "idle", "scanning", "connecting", "discovering", "subscribed", "backoff" };
+    return s <= BLE_BACKOFF ? names[s] : "?";
+  }
+
+private:
+  void handle(const BleEvent &e, uint32_t now) {
+    switch (e.type) {
+    case BLE_FOUND:
+      if (_state != BLE_SCANNING) break; // late result after stopScan()
+      _stack->stopScan();
+      connect(e.addr, CONNECT_MS, false, now);
+      break;
+    case BLE_SCAN_END:
+      if (_state == BLE_SCANNING) fail(now);
+      break;
+    case BLE_CONNECTED:
+      if (_state != BLE_CONNECTING) {
+        dropLink(); // completed after we gave up on it
+        break;
+      }
+      if (_stack->setup()) enter(BLE_DISCOVERING, now);
+      else {
+        dropLink();
+        fail(now);
+      }
+      break;
+    case BLE_CONNECT_FAILED:
+      if (_state == BLE_CONNECTING) connectFailed(now);
+      break;
+    case BLE_DISCONNECTED:
+      _stack->release();
+      if (_staleDisconnects) {
+        // a link already given up on, maybe after the next attempt has started
+        _staleDisconnects--;
+        break;
+      }
+      if (_state == BLE_SUBSCRIBED) {
+        // try the peer straight away: a dropped link is usually back within an advertising interval
+        _failures++;
+        _downSince = now;
+        attempt(now);
+      } else if (_state == BLE_CONNECTING || _state == BLE_DISCOVERING) {
+        fail(now);
+      }
+      break;
+    }
+  }
+
+  static bool samePeer(const BleAddress &a, const BleAddress &b) {
+    for (uint8_t i = 0; i < sizeof(a.val); i++) {
+      if (a.val[i] != b.val[i]) return false;
+    }
+    return a.type == b.type;
+  }
+
+  // Drop a link that is up and has been given up on. Its DISCONNECTED, however
+  // late, then only releases it and leaves the current attempt alone.
+  void dropLink() {
+    _stack->disconnect();
+    _staleDisconnects++;
+  }
+
+  // Straight to the known peer if there is one, else scan
+  void attempt(uint32_t now) {
+    if (_hasKnown) connect(_known, DIRECT_CONNECT_MS, true, now);
+    else scan(now);
+  }
+
+  void connect(const BleAddress &peer, uint32_t timeoutMs, bool direct, uint32_t now) {
+    _peer = peer;
+    _direct = direct;
+    _connectMs = timeoutMs;
+    if (_stack->connect(peer, timeoutMs)) enter(BLE_CONNECTING, now);
+    else connectFailed(now);
+  }
+
+  // A direct attempt falls back to scanning at once, a scanned one backs off
+  void connectFailed(uint32_t now) {
+    if (_direct) scan(now);
+    else fail(now);
+  }
+
+  void scan(uint32_t now) {
+    if (_stack->startScan(SCAN_MS)) enter(BLE_SCANNING, now);
+    else fail(now);
+  }
+
+  // Wait out the current backoff, and double it for next time
+  void fail(uint32_t now) {
+    _failures++;
+    _waitMs = _backoffMs;
+    _backoffMs = _backoffMs * 2 < BACKOFF_MAX_MS ? _backoffMs * 2 : BACKOFF_MAX_MS;
+    enter(BLE_BACKOFF, now);
+  }
+
+  void enter(BleState s, uint32_t now) {
+    _state = s;
+    _since = now;
+  }
+
+  BleStack *_stack = nullptr;
+  SpscRing<BleEvent, 16> _events;
+  BleState _state = BLE_IDLE;
+  uint32_t _since = 0;     // when the current state was entered
+  uint32_t _downSince = 0; // when the link was last lost
+  uint32_t _backoffMs = BACKOFF_MIN_MS;
+  uint32_t _waitMs = 0;
+  BleAddress _peer = {};  // being connected to, or last connected
+  BleAddress _known = {}; // tried directly first
+  bool _hasKnown = false;
+  bool _direct = false;
+  uint32_t _connectMs = 0;
+  uint8_t _staleDisconnects = 0; // DISCONNECTEDs still due from dropLink()
+  PeerFn _onNewPeer = nullptr;
+  uint32_t _connects = 0;
+  uint32_t _failures = 0;
+  uint32_t _lastReconnectMs = 0;
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <NimBLEDevice.h>
+#include <ble_link.h>
+#include <ble_session.h>
+#include <ble_setup_gate.h>
+#include <ble_scan.h>
+
+// BleStack on NimBLE-Arduino. Scans and connects are started asynchronously
+// and their callbacks, which run in the NimBLE host task, post events to the
+// link. GATT discovery and the subscribe write wait for round trips, so they
+// run on a small worker task instead of the caller's. The characteristic they
+// find is cached in the session until the link drops. One client is created
+// in begin() and reused for every connection; only the remote attributes are
+// freed when a connection ends. Scans report each device once (the
+// controller drops duplicates), keep no result list, and post the first
+// connectable device whose advertisement lists the service, as soon as it is
+// heard.
+
+class NimBleStack : public BleStack, public NimBLEScanCallbacks, public NimBLEClientCallbacks {
+public:
+  // UUIDs in text form
+  NimBleStack(BleLink &link, const char *service, const char *characteristic,
+              NimBLERemoteCharacteristic::notify_callback onNotify)
+    : _link(link), _service(service), _characteristic(characteristic), _onNotify(onNotify) {
+    parseUuid128(service, _serviceBytes);
+  }
+
+  // Scan timing, before begin()
+  void setScanConfig(const BleScanConfig &config) { _scanConfig = config; }
+
+  // Call once, after NimBLEDevice::init()
+  bool begin();
+
+  bool startScan(uint32_t durationMs) override;
+  void stopScan() override;
+  bool connect(const BleAddress &peer, uint32_t timeoutMs) override;
+  bool setup() override;
+  BleSetup setupState() override { return _setup.load(); }
+  void disconnect() override;
+  void release() override;
+
+  // Read the characteristic through the cached handle: one round trip, no
+  // lookups. Blocks, so not from loop(); false without a session.
+  bool read(NimBLEAttValue &value);
+  const BleSession<NimBLERemoteCharacteristic> &session() const { return _session; }
+
+  // NimBLE callbacks, host task
+  void onDiscovered(const NimBLEAdvertisedDevice *device) override;
+  void onResult(const NimBLEAdvertisedDevice *device) override;
+  void onScanEnd(const NimBLEScanResults &results, int reason) override;
+  void onConnect(NimBLEClient *client) override;
+  void onConnectFail(NimBLEClient *client, int reason) override;
+  void onDisconnect(NimBLEClient *client, int reason) override;
+
+private:
+  static void workerEntry(void *arg);
+  void match(const NimBLEAdvertisedDevice *device);
+  bool subscribe();
+  NimBLERemoteCharacteristic *discover();
+  void freeAttributes();
+
+  BleLink &_link;
+  NimBLEUUID _service;
+  uint8_t _serviceBytes[16] = {};
+  BleScanConfig _scanConfig = BLE_SCAN_FAST;
+  std::atomic<bool> _matched{false}; // this scan has posted its device
+  NimBLEUUID _characteristic;
+  NimBLERemoteCharacteristic::notify_callback _onNotify;
+  NimBLEClient *_client = nullptr;
+  TaskHandle_t _worker = nullptr;
+  std::atomic<BleSetup> _setup{BLE_SETUP_BUSY};
+  // Whether the worker is inside discovery, which release() must not free under it
+  BleSetupGate _gate;
+  BleSession<NimBLERemoteCharacteristic> _session;
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Scan-side filtering for the controller's service. Every advertisement the
+// radio hears reaches the scan callback in the NimBLE host task, so the match
+// runs on the raw advertising payload: no UUID objects, no allocation, and no
+// waiting for the scan response when the service is in the advertisement
+// itself. Only the first match is posted; BleLink stops the scan when it
+// takes it.
+
+// Scan timing: the radio listens for windowMs out of every intervalMs, so
+// window == interval listens continuously and finds the controller in about
+// one of its advertising intervals, at the cost of keeping the radio on for
+// the (short) scan. Active scanning also asks each device for its scan
+// response, only needed if the service UUID is not in the advertisement.
+struct BleScanConfig {
+  uint16_t intervalMs;
+  uint16_t windowMs;
+  bool active;
+};
+
+const BleScanConfig BLE_SCAN_FAST = { 60, 60, true };
+
+inline int8_t hexDigit(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// 128-bit UUID in advertising byte order (little-endian) from its
+// "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx" text form, false if malformed
+inline bool parseUuid128(const char *text, uint8_t out[16]) {
+  int8_t byte = 15;
+  for (const char *p = text; *p;) {
+    if (*p == '-') {
+      p++;
+      continue;
+    }
+    const int8_t hi = hexDigit(p[0]);
+    const int8_t lo = hi < 0 ? -1 : hexDigit(p[1]);
+    if (lo < 0 || byte < 0) return false;
+    out[byte--] = (uint8_t)(hi << 4 | lo);
+    p += 2;
+  }
+  return byte == -1;
+}
+
+// Whether an advertising payload (advertisement, optionally followed by the
+// scan response) lists `uuid` among its 128-bit service UUIDs. Malformed AD
+// structures end the search rather than being read past.
+inline bool advertisesService(const uint8_t *payload, size_t len, const uint8_t uuid[16]) {
+  const uint8_t AD_UUID128_MORE = 0x06, AD_UUID128_ALL = 0x07;
+  size_t i = 0;
+  while (i + 1 < len) {
+    const uint8_t fieldLen = payload[i]; // type byte plus data
+    if (fieldLen == 0 || i + 1 + fieldLen > len) return false;
+    const uint8_t type = payload[i + 1];
+    if (type == AD_UUID128_MORE || type == AD_UUID128_ALL) {
+      for (size_t u = i + 2; u + 16 <= i + 1 + fieldLen; u += 16) {
+        uint8_t diff = 0;
+        for (uint8_t b = 0; b < 16; b++) diff |= payload[u + b] ^ uuid[b];
+        if (!diff) return true;
+      }
+    }
+    i += 1 + fieldLen;
+  }
+  return false;
+}
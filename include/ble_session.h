@@ -0,0 +1,59 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+// The connected peer's telemetry characteristic, resolved by GATT discovery
+// once per connection and cached until the link drops, so reads and
+// subscribes after that are a pointer load instead of a service and
+// characteristic lookup. Bound by the task that ran discovery, invalidated
+// from the disconnect callback and again right before the attributes are
+// freed (discovery can bind after the disconnect), read from anywhere.
+// Every lookup is counted; with the cache working the count only grows when
+// a connection is made, which PerMinute turns into a rate for the stats.
+
+template <typename Characteristic>
+class BleSession {
+public:
+  // Count one service or characteristic lookup about to be made
+  void lookup() { _lookups.fetch_add(1, std::memory_order_relaxed); }
+  void bind(Characteristic *c) { _characteristic.store(c, std::memory_order_release); }
+  void invalidate() { _characteristic.store(nullptr, std::memory_order_release); }
+
+  // Cached handle, null without a connection or before discovery
+  Characteristic *get() const { return _characteristic.load(std::memory_order_acquire); }
+  uint32_t lookups() const { return _lookups.load(std::memory_order_relaxed); }
+
+private:
+  std::atomic<Characteristic *> _characteristic{nullptr};
+  std::atomic<uint32_t> _lookups{0};
+};
+
+// How much a running total grew over the last minute, in 10 s buckets.
+// Sampled from one task, e.g. BleSession::lookups() from the stats print.
+class PerMinute {
+public:
+  static const uint8_t BUCKETS = 6;
+  static const uint32_t BUCKET_MS = 10000;
+
+  uint32_t update(uint32_t now, uint32_t total) {
+    const uint32_t bucket = now / BUCKET_MS;
+    uint32_t steps = bucket - _bucket;
+    if (steps > BUCKETS) steps = BUCKETS;
+    while (steps--) {
+      _current = (_current + 1) % BUCKETS;
+      _counts[_current] = 0;
+    }
+    _bucket = bucket;
+    _counts[_current] += total - _total;
+    _total = total;
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < BUCKETS; i++) sum += _counts[i];
+    return sum;
+  }
+
+private:
+  uint32_t _counts[BUCKETS] = {};
+  uint8_t _current = 0;
+  uint32_t _bucket = 0;
+  uint32_t _total = 0;
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+
+// Who frees a connection's remote attributes. GATT discovery runs on a worker
+// task and builds them as it goes; BleLink calls release() from loop() when
+// the link drops, which may be while discovery is still walking them. Then
+// release() leaves them to the worker, which frees them when it finishes.
+// Both sides decide with one atomic exchange each, so exactly one of them
+// frees every set, whichever order the two land in.
+//
+//   IDLE --beginSetup()--> BUSY --endSetup()--> IDLE
+//                           |                     ^
+//                       release()                 | endSetup() returns true:
+//                           v                     | the worker frees
+//                      BUSY_RELEASE --------------+
+//
+// release() returning true means the caller frees them, at once.
+
+class BleSetupGate {
+public:
+  // From the task starting setup: false while the worker is still busy with an
+  // earlier link's discovery (one that timed out)
+  bool beginSetup() {
+    uint8_t idle = IDLE;
+    return _state.compare_exchange_strong(idle, BUSY);
+  }
+
+  // From the worker when discovery is done: true if release() came while it
+  // ran, and the worker must now free the attributes
+  bool endSetup() { return _state.exchange(IDLE) == BUSY_RELEASE; }
+
+  // When the connection ends: true if the caller may free the attributes now,
+  // false if the worker is still discovering and will free them itself
+  bool release() {
+    uint8_t busy = BUSY;
+    return !_state.compare_exchange_strong(busy, BUSY_RELEASE) && busy != BUSY_RELEASE;
+  }
+
+  // Whether discovery is running, for stats and tests
+  bool busy() const { return _state.load() != IDLE; }
+
+private:
+  enum State : uint8_t { IDLE, BUSY, BUSY_RELEASE };
+  std::atomic<uint8_t> _state{IDLE};
+};
@@ -0,0 +1,192 @@
+#pragma once
+#include <stdint.h>
+#include <TFT_eSPI.h>
+#include <round_mask.h>
+
+// Dirty-rectangle tracking so only the parts of a sprite that changed get
+// pushed over SPI. Widgets report the boxes they draw into; overlapping or
+// nearby boxes are merged so each push stays a handful of windows. On a round
+// panel the windows are cut down to the visible circle when they are sent.
+
+struct DirtyRect {
+  int16_t x, y, w, h;
+
+  int32_t area() const { return (int32_t)w * h; }
+  int16_t right() const { return x + w; }
+  int16_t bottom() const { return y + h; }
+
+  DirtyRect united(const DirtyRect &o) const {
+    int16_t l = x < o.x ? x : o.x;
+    int16_t t = y < o.y ? y : o.y;
+    int16_t r = right() > o.right() ? right() : o.right();
+    int16_t b = bottom() > o.bottom() ? bottom() : o.bottom();
+    DirtyRect u = { l, t, (int16_t)(r - l), (int16_t)(b - t) };
+    return u;
+  }
+};
+
+class DirtyRegion {
+public:
+  static const uint8_t MAX_RECTS = 12;
+  // Extra pixels we accept pushing to save one window (command overhead on the bus)
+  static const int32_t MERGE_SLACK = 64;
+  // CASET + RASET + RAMWR with their parameters, sent for every window
+  static const uint32_t WINDOW_OVERHEAD_BYTES = 11;
+
+  // round: the frame is a round panel's, only pixels inside roundMask are sent
+  DirtyRegion(int16_t w, int16_t h, bool round = false)
+    : _w(w), _h(h), _round(round && w == ROUND_SIZE && h == ROUND_SIZE) {}
+
+  void clear() { _count = 0; }
+  void addAll() {
+    DirtyRect full = { 0, 0, _w, _h };
+    _rects[0] = full;
+    _count = 1;
+  }
+
+  void add(int32_t x, int32_t y, int32_t w, int32_t h) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > _w) w = _w - x;
+    if (y + h > _h) h = _h - y;
+    if (w <= 0 || h <= 0) return;
+    DirtyRect r = { (int16_t)x, (int16_t)y, (int16_t)w, (int16_t)h };
+    add(r);
+  }
+
+  void add(const DirtyRect &in) {
+    DirtyRect r = in;
+    // Keep absorbing existing rects while that is cheaper than pushing them separately
+    bool merged = true;
+    while (merged) {
+      merged = false;
+      for (uint8_t i = 0; i < _count; i++) {
+        DirtyRect u = r.united(_rects[i]);
+        if (u.area() <= r.area() + _rects[i].area() + MERGE_SLACK) {
+          r = u;
+          _rects[i] = _rects[--_count];
+          merged = true;
+          break;
+        }
+      }
+    }
+    if (_count == MAX_RECTS) {
+      // Out of slots, fold into whichever rect grows the least
+      uint8_t best = 0;
+      int32_t bestGrowth = INT32_MAX;
+      for (uint8_t i = 0; i < _count; i++) {
+        int32_t growth = r.united(_rects[i]).area() - _rects[i].area();
+        if (growth < bestGrowth) {
+          bestGrowth = growth;
+          best = i;
+        }
+      }
+      r = r.united(_rects[best]);
+      _rects[best] = _rects[--_count];
+      add(r);
+      return;
+    }
+    _rects[_count++] = r;
+  }
+
+  void add(const DirtyRegion &o) {
+    for (uint8_t i = 0; i < o._count; i++) add(o._rects[i]);
+  }
+
+  uint8_t count() const { return _count; }
+  const DirtyRect &operator[](uint8_t i) const { return _rects[i]; }
+
+  // Calls fn(const DirtyRect &) for every window to send. On a round panel each
+  // rect is cut into bands of rows around their visible spans, starting a new
+  // band when widening the current one would cost more than a window's commands.
+  template <class Fn>
+  void forEachWindow(Fn fn) const {
+    for (uint8_t i = 0; i < _count; i++) {
+      const DirtyRect &r = _rects[i];
+      if (!_round) {
+        fn(r);
+        continue;
+      }
+      int32_t bx0 = 0, bx1 = -1, by = 0, rows = 0;
+      for (int32_t y = r.y; y <= r.bottom(); y++) {
+        int32_t a = r.x, b = r.right() - 1;
+        const bool visible = y < r.bottom() && roundMask.clip(y, a, b);
+        if (rows && visible) {
+          const int32_t ux0 = a < bx0 ? a : bx0;
+          const int32_t ux1 = b > bx1 ? b : bx1;
+          const int32_t joined = (ux1 - ux0 + 1) * (rows + 1) * 2;
+          const int32_t apart = (bx1 - bx0 + 1) * rows * 2 + (b - a + 1) * 2 + WINDOW_OVERHEAD_BYTES;
+          if (joined <= apart) {
+            bx0 = ux0;
+            bx1 = ux1;
+            rows++;
+            continue;
+          }
+        }
+        if (rows) {
+          DirtyRect band = { (int16_t)bx0, (int16_t)by, (int16_t)(bx1 - bx0 + 1), (int16_t)rows };
+          fn(band);
+          rows = 0;
+        }
+        if (visible) {
+          bx0 = a;
+          bx1 = b;
+          by = y;
+          rows = 1;
+        }
+      }
+    }
+  }
+
+private:
+  int16_t _w, _h;
+  bool _round;
+  DirtyRect _rects[MAX_RECTS];
+  uint8_t _count = 0;
+};
+
+// Per-screen tracker. The frame sprite is fully redrawn every frame, so a pixel
+// can only differ from what the panel shows if a widget drew there this frame
+// or the previous one; both frames' regions are pushed.
+class DirtyTracker {
+public:
+  static const uint32_t WINDOW_OVERHEAD_BYTES = DirtyRegion::WINDOW_OVERHEAD_BYTES;
+
+  DirtyTracker(int16_t w, int16_t h, bool round = false) : _cur(w, h, round), _prev(w, h, round) { _cur.addAll(); }
+
+  DirtyRegion &region() { return _cur; }
+  void mark(int32_t x, int32_t y, int32_t w, int32_t h) { _cur.add(x, y, w, h); }
+  void markAll() { _cur.addAll(); }
+
+  // Finish the frame: returns the windows that need sending and starts a new frame
+  DirtyRegion take() {
+    DirtyRegion out = _cur;
+    out.add(_prev);
+    uint32_t bytes = 0;
+    out.forEachWindow([&](const DirtyRect &r) { bytes += (uint32_t)r.area() * 2 + WINDOW_OVERHEAD_BYTES; });
+    _prev = _cur;
+    _cur.clear();
+    _lastBytes = bytes;
+    _totalBytes += bytes;
+    _frames++;
+    return out;
+  }
+
+  // Push the dirty windows of spr to the panel at (0,0) and start a new frame
+  uint32_t push(TFT_eSprite &spr) {
+    DirtyRegion out = take();
+    out.forEachWindow([&](const DirtyRect &r) { spr.pushSprite(r.x, r.y, r.x, r.y, r.w, r.h); });
+    return _lastBytes;
+  }
+
+  uint32_t lastFrameBytes() const { return _lastBytes; }
+  uint32_t averageFrameBytes() const { return _frames ? (uint32_t)(_totalBytes / _frames) : 0; }
+  void resetStats() { _totalBytes = 0; _frames = 0; }
+
+private:
+  DirtyRegion _cur;
+  DirtyRegion _prev;
+  uint32_t _lastBytes = 0;
+  uint64_t _totalBytes = 0;
+  uint32_t _frames = 0;
+};
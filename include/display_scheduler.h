@@ -0,0 +1,190 @@
+#pragma once
+#include <stdint.h>
+#include <TFT_eSPI.h>
+#include <dirty_rects.h>
+#include <frame_pipeline.h>
+
+// Owns the panels sharing the SPI bus: their chip selects, rotations, frame
+// sprites and dirty trackers. Every tick() it renders at most one panel, the
+// one whose next frame is most overdue (earliest deadline first), so each
+// panel runs at its own target rate and one panel's render overlaps the other's
+// transfer in the frame pipeline. Panels that are not animated are only
+// redrawn after invalidate().
+
+class DisplayScheduler {
+public:
+  typedef void (*RenderFn)(TFT_eSprite &spr, DirtyTracker &dirty);
+  typedef void (*ChipSelectFn)(int8_t panel); // select one panel, -1 for none
+  static const uint8_t MAX_PANELS = FramePipeline::MAX_SCREENS;
+  static const uint32_t STATS_PERIOD_MS = 1000;
+
+  DisplayScheduler(TFT_eSPI *tft)
+    : _tft(tft),
+      _frames{ TFT_eSprite(tft), TFT_eSprite(tft), TFT_eSprite(tft), TFT_eSprite(tft) },
+      _pipeline(tft, selectThunk, this) {}
+
+  // Returns the panel index, or -1 if there is no room. Frames are 8-bit RGB332, or
+  // 4-bit indexed into `palette` (16 RGB565 entries, must outlive the scheduler) if one
+  // is given: half the RAM, and render draws with palette indices instead of colours.
+  int8_t addPanel(uint8_t csPin, uint8_t rotation, uint16_t targetHz, bool animated, RenderFn render,
+                  const uint16_t *palette = nullptr) {
+    if (_count >= MAX_PANELS) return -1;
+    Panel &p = _panels[_count];
+    p.csPin = csPin;
+    p.rotation = rotation;
+    p.periodUs = 1000000UL / (targetHz ? targetHz : 1);
+    p.animated = animated;
+    p.render = render;
+    p.palette = palette;
+    return _count++;
+  }
+
+  // Replace the digitalWrite chip-select path, e.g. with FastChipSelect<...>::select.
+  // The function must know the panels' pins in the order they were added.
+  void setChipSelect(ChipSelectFn cs) { _cs = cs; }
+
+  // Init every panel and create the frame sprites. Call start() afterwards, once
+  // anything else that wants PSRAM sprites (layer caches) has been allocated.
+  bool begin() {
+    for (uint8_t i = 0; i < _count; i++) {
+      pinMode(_panels[i].csPin, OUTPUT);
+      digitalWrite(_panels[i].csPin, HIGH);
+    }
+    // each panel needs its own init sequence
+    for (uint8_t i = 0; i < _count; i++) {
+      select(i);
+      _tft->init();
+    }
+    for (uint8_t i = 0; i < _count; i++) {
+      select(i);
+      _tft->setRotation(_panels[i].rotation);
+      _tft->fillScreen(TFT_BLACK);
+      // frames and dirty windows in the panel's own size, as rotated
+      _panels[i].width = _tft->width();
+      _panels[i].height = _tft->height();
+      _panels[i].dirty = DirtyTracker(_panels[i].width, _panels[i].height, true);
+    }
+    deselectAll();
+
+    bool ok = true;
+    for (uint8_t i = 0; i < _count; i++) {
+      ok &= createFrame(_frames[2 * i], _panels[i]);
+      ok &= createFrame(_frames[2 * i + 1], _panels[i]);
+      _pipeline.addScreen(i, &_frames[2 * i], &_frames[2 * i + 1]);
+    }
+    return ok;
+  }
+
+  bool start() {
+    _statsStart = millis();
+    return _pipeline.begin();
+  }
+
+  // Render and queue the most overdue panel. Returns its index, or -1 if none was due.
+  int8_t tick() {
+    const uint32_t now = micros();
+    int8_t best = -1;
+    int32_t bestLate = INT32_MIN;
+    for (uint8_t i = 0; i < _count; i++) {
+      Panel &p = _panels[i];
+      if (!p.animated && !p.invalid) continue;
+      int32_t late = (int32_t)(now - p.nextDue);
+      if (late >= 0 && late > bestLate) {
+        bestLate = late;
+        best = i;
+      }
+    }
+    if (best >= 0) {
+      Panel &p = _panels[best];
+      p.invalid = false;
+      // schedule from the deadline, not from now, unless we fell a whole period behind
+      p.nextDue = (bestLate > (int32_t)p.periodUs) ? now + p.periodUs : p.nextDue + p.periodUs;
+      p.render(_pipeline.acquire(best), p.dirty);
+      _pipeline.submit(best, p.dirty.take());
+      p.frameCount++;
+    }
+    updateStats();
+    return best;
+  }
+
+  // Content of a non-animated panel changed, redraw it at its next slot
+  void invalidate(uint8_t panel) { _panels[panel].invalid = true; }
+
+  // Drive the chip selects directly; only safe while nothing is queued (see waitIdle)
+  void select(uint8_t panel) {
+    if (_cs) {
+      _cs(panel);
+      return;
+    }
+    for (uint8_t i = 0; i < _count; i++) {
+      digitalWrite(_panels[i].csPin, i == panel ? LOW : HIGH);
+    }
+  }
+  void deselectAll() {
+    if (_cs) {
+      _cs(-1);
+      return;
+    }
+    for (uint8_t i = 0; i < _count; i++) digitalWrite(_panels[i].csPin, HIGH);
+  }
+  void waitIdle() { _pipeline.waitIdle(); }
+
+  DirtyTracker &dirty(uint8_t panel) { return _panels[panel].dirty; }
+  // Frames per second each panel achieved over the last stats period
+  float achievedFps(uint8_t panel) const { return _panels[panel].fps; }
+  // Fraction of the last stats period the bus spent sending frames
+  float busUtilisation() const { return _busUtil; }
+
+private:
+  struct Panel {
+    uint8_t csPin = 0;
+    uint8_t rotation = 0;
+    uint32_t periodUs = 0;
+    uint32_t nextDue = 0;
+    bool animated = false;
+    bool invalid = true; // draw everything once
+    RenderFn render = nullptr;
+    const uint16_t *palette = nullptr; // 4-bit frames when set
+    int16_t width = 0, height = 0;
+    // sized in begin(); a round GC9A01 only gets its visible circle sent
+    DirtyTracker dirty{ 0, 0, true };
+    uint32_t frameCount = 0;
+    float fps = 0;
+  };
+
+  static void selectThunk(void *ctx, uint8_t panel) { ((DisplayScheduler *)ctx)->select(panel); }
+
+  bool createFrame(TFT_eSprite &spr, const Panel &p) {
+    const uint16_t *palette = p.palette;
+    spr.setColorDepth(palette ? 4 : 8); // MUST set before creating sprite
+    // a 4-bit 240x240 frame is ~28 KB, small enough for internal RAM, which is faster to read than PSRAM
+    if (palette) spr.setAttribute(PSRAM_ENABLE, false);
+    bool ok = spr.createSprite(p.width, p.height) != nullptr;
+    if (!ok) {
+      Serial.println("Sprite creation failed - try lower color depth or enable PSRAM.");
+      return false;
+    }
+    if (palette) spr.createPalette(palette, 16);
+    return true;
+  }
+
+  void updateStats() {
+    const uint32_t elapsed = millis() - _statsStart;
+    if (elapsed < STATS_PERIOD_MS) return;
+    for (uint8_t i = 0; i < _count; i++) {
+      _panels[i].fps = _panels[i].frameCount * 1000.0f / elapsed;
+      _panels[i].frameCount = 0;
+    }
+    _busUtil = _pipeline.takeBusyMicros() / (elapsed * 1000.0f);
+    _statsStart = millis();
+  }
+
+  TFT_eSPI *_tft;
+  Panel _panels[MAX_PANELS];
+  uint8_t _count = 0;
+  ChipSelectFn _cs = nullptr;
+  TFT_eSprite _frames[2 * MAX_PANELS];
+  FramePipeline _pipeline;
+  uint32_t _statsStart = 0;
+  float _busUtil = 0;
+};
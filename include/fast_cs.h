@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+#include <soc/gpio_struct.h>
+
+// Chip-select switching for panels sharing one SPI bus, written straight to
+// the GPIO set/clear registers instead of going through digitalWrite.
+// The pins are template parameters, so the masks are compile-time constants and
+// switching panels is two register stores: deselect the others, select one.
+// Pins must be outputs already (pinMode) and below 32, which covers the CS pins
+// this board uses; higher pins would need the out1_w1ts/out1_w1tc registers.
+//
+// This is not wired into TFT_eSPI's transaction hooks (TFT_CS_L/TFT_CS_H in
+// begin_tft_write/end_tft_write), and is not meant to be: one TFT_CS can only
+// name one panel. User_Setup.h sets TFT_CS to -1, so the library never touches
+// a CS pin, and DisplayScheduler calls select() itself, through
+// setChipSelect(), around each panel's init and each frame the pipeline sends.
+// The selected panel stays selected across the library's transactions.
+
+template <uint8_t... Pins>
+struct FastChipSelect {
+  static_assert(sizeof...(Pins) > 0, "need at least one CS pin");
+
+  static constexpr uint32_t maskOf(uint8_t pin) { return 1UL << pin; }
+  static constexpr uint32_t allMask() { return (0UL | ... | maskOf(Pins)); }
+  static constexpr bool pinsValid() { return ((Pins < 32) && ...); }
+  static_assert(pinsValid(), "FastChipSelect only handles GPIO 0..31");
+
+  // Mask of the n-th pin in the parameter list
+  static inline uint32_t panelMask(int8_t panel) {
+    static const uint32_t masks[] = { maskOf(Pins)... };
+    return masks[panel];
+  }
+
+  // Select one panel (CS low) and deselect the rest; -1 deselects all
+  static inline void select(int8_t panel) {
+    if (panel < 0 || panel >= (int8_t)sizeof...(Pins)) {
+      GPIO.out_w1ts = allMask();
+      return;
+    }
+    const uint32_t on = panelMask(panel);
+    GPIO.out_w1ts = allMask() & ~on; // deselect first so two panels never listen at once
+    GPIO.out_w1tc = on;
+  }
+};
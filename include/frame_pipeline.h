@@ -0,0 +1,206 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <TFT_eSPI.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <esp_heap_caps.h>
+#include <dirty_rects.h>
+#include <frame_profiler.h>
+#include <pixel_expand.h>
+
+// Double-buffered render pipeline for the shared SPI bus.
+//
+// Each screen has two frame sprites, 8-bit RGB332 or 4-bit palettised. The
+// render loop draws into the back buffer while a task on the other core sends
+// the front buffer out: every dirty window is expanded to RGB565 into a small
+// ping-pong line buffer in internal RAM and clocked out with SPI DMA, so the
+// next chunk is converted while the previous one is on the wire. Windows of
+// round panels are cut to the visible circle (DirtyRegion::forEachWindow), and
+// windows of 4-bit screens widened to even x and width, so they expand whole bytes. The transfer task is the only thing that touches
+// the bus or the chip selects; anything else that wants the bus (loading screen,
+// setup) must call waitIdle() first.
+
+class FramePipeline {
+public:
+  typedef void (*SelectFn)(void *ctx, uint8_t screen); // drive the chip selects for one panel
+  static const uint8_t MAX_SCREENS = 2;
+  static const uint32_t CHUNK_PIXELS = 1024; // per DMA transfer, x2 buffers
+
+  FramePipeline(TFT_eSPI *tft, SelectFn select, void *selectCtx)
+    : _tft(tft), _select(select), _selectCtx(selectCtx) {}
+
+  // Call after both sprites of every screen are created, so they stay in PSRAM
+  // (TFT_eSprite avoids PSRAM once DMA is enabled).
+  void addScreen(uint8_t screen, TFT_eSprite *a, TFT_eSprite *b) {
+    if (screen >= MAX_SCREENS) return;
+    _screens[screen].buf[0] = a;
+    _screens[screen].buf[1] = b;
+    _screens[screen].back = 0;
+  }
+
+  bool begin(BaseType_t core = 0) {
+    // 8-bit sprite colour to byte-swapped RGB565, as pushSprite would expand it
+    for (int i = 0; i < 256; i++) _lut[i] = pixels::swap565(_tft->color8to16((uint8_t)i));
+    // 4-bit screens: both pixels of a byte, from the sprites' palette (shared by both buffers)
+    for (uint8_t s = 0; s < MAX_SCREENS; s++) {
+      TFT_eSprite *spr = _screens[s].buf[0];
+      if (!spr || spr->getColorDepth() != 4) continue;
+      uint16_t palette[16];
+      for (uint8_t i = 0; i < 16; i++) palette[i] = spr->getPaletteColor(i);
+      pixels::buildPairLut(_screens[s].pairs, palette);
+    }
+    for (int i = 0; i < 2; i++) {
+      _line[i] = (uint16_t *)heap_caps_malloc(CHUNK_PIXELS * 2, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+      if (!_line[i]) return false;
+    }
+    for (uint8_t s = 0; s < MAX_SCREENS; s++) {
+      for (uint8_t b = 0; b < 2; b++) {
+        _screens[s].free[b] = xSemaphoreCreateBinary();
+        if (!_screens[s].free[b]) return false;
+        xSemaphoreGive(_screens[s].free[b]);
+      }
+    }
+    _jobs = xQueueCreate(MAX_SCREENS * 2, sizeof(Job));
+    if (!_jobs) return false;
+    if (!_tft->initDMA()) return false;
+    if (xTaskCreatePinnedToCore(taskEntry, "framePush", 4096, this, 2, &_task, core) != pdPASS) return false;
+    _running = true;
+    return true;
+  }
+
+  // Back buffer of a screen, waits if it is still being sent from two frames ago
+  TFT_eSprite &acquire(uint8_t screen) {
+    Screen &s = _screens[screen];
+    if (_running && !s.held) {
+      xSemaphoreTake(s.free[s.back], portMAX_DELAY);
+      s.held = true;
+    }
+    return *s.buf[s.back];
+  }
+
+  // Queue the acquired back buffer for sending and flip to the other buffer
+  void submit(uint8_t screen, const DirtyRegion &region) {
+    Screen &s = _screens[screen];
+    if (!_running) {
+      // no task or DMA: push synchronously like before
+      PROFILE_ZONE(PROF_PUSH);
+      uint32_t start = micros();
+      _select(_selectCtx, screen);
+      TFT_eSprite *spr = s.buf[s.back];
+      region.forEachWindow([&](const DirtyRect &r) { spr->pushSprite(r.x, r.y, r.x, r.y, r.w, r.h); });
+      _busyMicros += micros() - start;
+      return;
+    }
+    Job job = { screen, s.back, region };
+    s.held = false;
+    xQueueSend(_jobs, &job, portMAX_DELAY);
+    s.back ^= 1;
+  }
+
+  // Fence: returns once every queued frame is on the panel
+  void waitIdle() {
+    if (!_running) return;
+    for (uint8_t s = 0; s < MAX_SCREENS; s++) {
+      for (uint8_t b = 0; b < 2; b++) {
+        if (_screens[s].held && b == _screens[s].back) continue;
+        xSemaphoreTake(_screens[s].free[b], portMAX_DELAY);
+        xSemaphoreGive(_screens[s].free[b]);
+      }
+    }
+  }
+
+  // Time the bus spent sending frames since the last call
+  uint32_t takeBusyMicros() { return _busyMicros.exchange(0); }
+
+private:
+  struct Screen {
+    TFT_eSprite *buf[2] = { nullptr, nullptr };
+    SemaphoreHandle_t free[2] = { nullptr, nullptr }; // given while the buffer is not in flight
+    uint32_t pairs[256]; // 4-bit screens only, see begin()
+    uint8_t back = 0;
+    bool held = false; // back buffer acquired by the render loop
+  };
+  struct Job {
+    uint8_t screen;
+    uint8_t buffer;
+    DirtyRegion region;
+  };
+
+  static void taskEntry(void *arg) { ((FramePipeline *)arg)->run(); }
+
+  void run() {
+    Job job = { 0, 0, DirtyRegion(0, 0) };
+    for (;;) {
+      if (xQueueReceive(_jobs, &job, portMAX_DELAY) != pdTRUE) continue;
+      uint32_t start = micros();
+      transfer(job);
+      _busyMicros += micros() - start;
+      xSemaphoreGive(_screens[job.screen].free[job.buffer]);
+    }
+  }
+
+  void transfer(const Job &job) {
+    PROFILE_ZONE(PROF_PUSH);
+    Screen &s = _screens[job.screen];
+    TFT_eSprite *spr = s.buf[job.buffer];
+    const uint8_t *px = (const uint8_t *)spr->getPointer();
+    const bool packed = spr->getColorDepth() == 4;
+    const int16_t stride = packed ? (spr->width() + 1) / 2 : spr->width();
+    // the previous job ended with dmaWait(), so switching panels here is safe
+    _select(_selectCtx, job.screen);
+    _tft->startWrite();
+    job.region.forEachWindow([&](const DirtyRect &r) {
+      int16_t x = r.x, w = r.w;
+      if (packed) {
+        x &= ~1;
+        w = ((r.right() + 1) & ~1) - x;
+      }
+      _tft->dmaWait(); // window commands must not overtake pixels still in flight
+      _tft->setAddrWindow(x, r.y, w, r.h);
+      uint32_t n = 0;
+      for (int16_t y = r.y; y < r.bottom(); y++) {
+        const uint8_t *src = px + y * stride + (packed ? x / 2 : x);
+        uint32_t left = w;
+        while (left) {
+          // CHUNK_PIXELS and w are even on 4-bit screens, so take stays even too
+          const uint32_t take = left < CHUNK_PIXELS - n ? left : CHUNK_PIXELS - n;
+          if (packed) {
+            pixels::expand4(src, _line[_ping] + n, take / 2, s.pairs);
+            src += take / 2;
+          } else {
+            pixels::expand8(src, _line[_ping] + n, take, _lut);
+            src += take;
+          }
+          n += take;
+          left -= take;
+          if (n == CHUNK_PIXELS) {
+            _tft->pushPixelsDMA(_line[_ping], n); // waits for the previous chunk first
+            _ping ^= 1;
+            n = 0;
+          }
+        }
+      }
+      if (n) {
+        _tft->pushPixelsDMA(_line[_ping], n);
+        _ping ^= 1;
+      }
+    });
+    _tft->dmaWait();
+    _tft->endWrite();
+  }
+
+  TFT_eSPI *_tft;
+  SelectFn _select;
+  void *_selectCtx;
+  Screen _screens[MAX_SCREENS];
+  QueueHandle_t _jobs = nullptr;
+  TaskHandle_t _task = nullptr;
+  uint16_t *_line[2] = { nullptr, nullptr };
+  uint8_t _ping = 0;
+  uint16_t _lut[256];
+  bool _running = false;
+  std::atomic<uint32_t> _busyMicros{0};
+};
@@ -0,0 +1,159 @@
+#pragma once
+#include <stdint.h>
+
+// Scoped frame-time profiler with a fixed set of named zones.
+//
+//   { PROFILE_ZONE(PROF_COMPASS); ...draw the compass... }
+//   PROFILE_REPORT(Serial); // CSV, then starts a new reporting period
+//
+// Zones are timed with the CPU cycle counter on the ESP32 and steady_clock on
+// the native build, and collected into per-zone histograms (exact below 16 us,
+// then 8 buckets per power of two, ~12% wide) from which min/avg/p99/max are
+// reported. Without -D FRAME_PROFILER every macro expands to nothing, so the
+// zones can stay in production code.
+//
+// Each zone should only be timed from one task. The report reads zones that
+// other tasks may be updating (the push runs on the transfer task), so a line
+// can be off by the one sample in flight.
+
+enum ProfileZone : uint8_t {
+  PROF_SCREEN0,   // whole updateScreen0()
+  PROF_COMPASS,   // compass letters
+  PROF_TICKS,     // compass tick marks
+  PROF_BOOST_ARC, // boost gauge
+  PROF_SHOCK,     // shock sensor gradient
+  PROF_BITMAP,    // scooter bitmap overlay
+  PROF_SCREEN1,   // whole updateScreen1()
+  PROF_MAP,       // map blit
+  PROF_PUSH,      // sending one frame to a panel
+  PROF_ZONE_COUNT
+};
+
+#ifdef FRAME_PROFILER
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <hal/cpu_hal.h>
+#else
+#include <chrono>
+#endif
+
+class FrameProfiler {
+public:
+  static const uint8_t EXACT_US = 16;   // values below this get a bucket each
+  static const uint8_t SUB_BUCKETS = 8; // per power of two above that
+  static const uint8_t MAX_POW = 20;    // ~1 s, anything slower lands in the last bucket
+  static const uint16_t BUCKETS = EXACT_US + (MAX_POW - 4) * SUB_BUCKETS;
+
+  static FrameProfiler &instance() {
+    static FrameProfiler p;
+    return p;
+  }
+
+  static const char *zoneName(uint8_t zone) {
+    static const char *const names[PROF_ZONE_COUNT] = {
+      "screen0", "compass", "ticks", "boost_arc", "shock", "bitmap", "screen1", "map", "push",
+    };
+    return zone < PROF_ZONE_COUNT ? names[zone] : "?";
+  }
+
+  static inline uint32_t now() {
+#ifdef ARDUINO
+    return cpu_hal_get_cycle_count();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  // Counter ticks per microsecond
+  static uint32_t ticksPerUs() {
+#ifdef ARDUINO
+    static const uint32_t mhz = getCpuFrequencyMhz();
+    return mhz;
+#else
+    return 1000;
+#endif
+  }
+
+  void record(uint8_t zone, uint32_t ticks) {
+    Zone &z = _zones[zone];
+    const uint32_t us = ticks / ticksPerUs();
+    z.hist[bucketOf(us)]++;
+    z.count++;
+    z.totalUs += us;
+    if (us < z.minUs) z.minUs = us;
+    if (us > z.maxUs) z.maxUs = us;
+  }
+
+  // One CSV line per zone that ran: prof,zone,count,min_us,avg_us,p99_us,max_us
+  // Out needs printf (Serial, or anything like it). Clears the stats afterwards.
+  template <class Out>
+  void report(Out &out) {
+    for (uint8_t i = 0; i < PROF_ZONE_COUNT; i++) {
+      Zone &z = _zones[i];
+      if (!z.count) continue;
+      out.printf("prof,%s,%u,%u,%u,%u,%u\n", zoneName(i), (unsigned)z.count, (unsigned)z.minUs,
+                 (unsigned)(z.totalUs / z.count), (unsigned)percentile(z, 99), (unsigned)z.maxUs);
+      z = Zone();
+    }
+  }
+
+  class Scope {
+  public:
+    explicit Scope(uint8_t zone) : _zone(zone), _start(now()) {}
+    ~Scope() { instance().record(_zone, now() - _start); }
+
+  private:
+    uint8_t _zone;
+    uint32_t _start;
+  };
+
+private:
+  struct Zone {
+    uint32_t hist[BUCKETS] = {};
+    uint32_t count = 0;
+    uint64_t totalUs = 0;
+    uint32_t minUs = UINT32_MAX;
+    uint32_t maxUs = 0;
+  };
+
+  static uint16_t bucketOf(uint32_t us) {
+    if (us < EXACT_US) return us;
+    uint8_t pow = 31 - __builtin_clz(us); // >= 4
+    if (pow >= MAX_POW) return BUCKETS - 1;
+    return EXACT_US + (pow - 4) * SUB_BUCKETS + ((us >> (pow - 3)) & (SUB_BUCKETS - 1));
+  }
+
+  // Upper edge of a bucket, so percentiles err on the slow side
+  static uint32_t bucketTop(uint16_t b) {
+    if (b < EXACT_US) return b;
+    const uint8_t pow = 4 + (b - EXACT_US) / SUB_BUCKETS;
+    const uint8_t sub = (b - EXACT_US) % SUB_BUCKETS;
+    return ((uint32_t)(SUB_BUCKETS + sub + 1) << (pow - 3)) - 1;
+  }
+
+  static uint32_t percentile(const Zone &z, uint8_t pct) {
+    const uint32_t rank = (z.count * pct + 99) / 100;
+    uint32_t seen = 0;
+    for (uint16_t b = 0; b < BUCKETS; b++) {
+      seen += z.hist[b];
+      if (seen >= rank) return bucketTop(b) < z.maxUs ? bucketTop(b) : z.maxUs;
+    }
+    return z.maxUs;
+  }
+
+  Zone _zones[PROF_ZONE_COUNT];
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(zone) FrameProfiler::Scope PROFILE_CONCAT(_profileScope, __LINE__)(zone)
+#define PROFILE_REPORT(out) FrameProfiler::instance().report(out)
+
+#else
+
+#define PROFILE_ZONE(zone) do {} while (0)
+#define PROFILE_REPORT(out) do {} while (0)
+
+#endif
@@ -0,0 +1,169 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include <TFT_eSPI.h>
+#include <round_mask.h>
+
+// Cache for the parts of a screen that never change between frames.
+//
+// Static widgets register a draw function as either an UNDER layer (drawn on
+// the background, below everything dynamic) or an OVER layer (drawn on top of
+// the dynamic widgets, e.g. a bitmap with transparent pixels). The layers are
+// rendered once: UNDER layers into a cached sprite that is memcpy'd into the
+// frame sprite at the start of every frame, OVER layers into a list of opaque
+// spans that are copied on top at the end of the frame.
+// Only 8-bit sprites are supported, the same depth as the frame sprites.
+// With a round mask, only the part of each row the panel can show is copied.
+
+class LayerCache {
+public:
+  typedef void (*DrawFn)(TFT_eSprite &spr);
+  enum Placement { UNDER, OVER };
+  static const uint8_t MAX_LAYERS = 8;
+
+  LayerCache(TFT_eSPI *tft, uint16_t background = TFT_BLACK, const RoundMask *visible = nullptr)
+    : _tft(tft), _under(tft), _background(background), _visible(visible) {}
+
+  // Opt a static widget into the cache. Layers draw in the order they are added.
+  bool addLayer(Placement where, DrawFn draw) {
+    if (_layerCount >= MAX_LAYERS) return false;
+    _layers[_layerCount].where = where;
+    _layers[_layerCount].draw = draw;
+    _layerCount++;
+    _stale = true;
+    return true;
+  }
+
+  // Render the cache now rather than on the first frame, e.g. so the cache
+  // sprite is allocated before DMA is enabled and still lands in PSRAM
+  bool prepare(int16_t w, int16_t h) { return !_stale || rebuild(w, h); }
+
+  // Force a re-render of the cached layers on the next frame
+  void invalidate() { _stale = true; }
+
+  // Copy the cached background into the frame sprite. Rebuilds the cache first if needed.
+  void beginFrame(TFT_eSprite &dst) {
+    if (_stale && !rebuild(dst.width(), dst.height())) {
+      // out of memory for the cache, draw the layers directly instead
+      dst.fillSprite(_background);
+      drawLayers(dst, UNDER);
+      return;
+    }
+    if (!round()) {
+      memcpy(dst.getPointer(), _under.getPointer(), (size_t)_w * _h);
+      return;
+    }
+    uint8_t *to = (uint8_t *)dst.getPointer();
+    const uint8_t *from = (const uint8_t *)_under.getPointer();
+    for (int16_t y = 0; y < _h; y++) {
+      const int32_t x0 = _visible->x0[y], x1 = _visible->x1[y];
+      if (x1 >= x0) memcpy(to + y * _w + x0, from + y * _w + x0, x1 - x0 + 1);
+    }
+  }
+
+  // Put the cached background back over part of the frame
+  void restore(TFT_eSprite &dst, int32_t x, int32_t y, int32_t w, int32_t h) {
+    if (_stale) return;
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > _w) w = _w - x;
+    if (y + h > _h) h = _h - y;
+    if (w <= 0 || h <= 0) return;
+    uint8_t *to = (uint8_t *)dst.getPointer();
+    const uint8_t *from = (const uint8_t *)_under.getPointer();
+    for (int32_t row = y; row < y + h; row++) {
+      int32_t a = x, b = x + w - 1;
+      if (round() && !_visible->clip(row, a, b)) continue;
+      memcpy(to + row * _w + a, from + row * _w + a, b - a + 1);
+    }
+  }
+
+  // Copy the cached OVER layers on top of the frame
+  void endFrame(TFT_eSprite &dst) {
+    if (_stale) {
+      drawLayers(dst, OVER);
+      return;
+    }
+    uint8_t *to = (uint8_t *)dst.getPointer();
+    for (size_t i = 0; i < _overSpans.size(); i++) {
+      const OverSpan &s = _overSpans[i];
+      memcpy(to + s.y * _w + s.x, &_overPixels[s.offset], s.len);
+    }
+  }
+
+private:
+  struct Layer {
+    Placement where;
+    DrawFn draw;
+  };
+  struct OverSpan {
+    int16_t y, x;
+    uint16_t len;
+    uint32_t offset; // into _overPixels
+  };
+
+  bool round() const { return _visible && _w == ROUND_SIZE && _h == ROUND_SIZE; }
+
+  void drawLayers(TFT_eSprite &dst, Placement where) {
+    for (uint8_t i = 0; i < _layerCount; i++) {
+      if (_layers[i].where == where) _layers[i].draw(dst);
+    }
+  }
+
+  bool rebuild(int16_t w, int16_t h) {
+    if (!_under.created() || w != _w || h != _h) {
+      _under.deleteSprite();
+      _under.setColorDepth(8);
+      if (!_under.createSprite(w, h)) return false; // lands in PSRAM when available
+      _w = w;
+      _h = h;
+    }
+    _under.fillSprite(_background);
+    drawLayers(_under, UNDER);
+    bool anyOver = false;
+    for (uint8_t i = 0; i < _layerCount; i++) {
+      if (_layers[i].where == OVER) anyOver = true;
+    }
+
+    _overSpans.clear();
+    _overPixels.clear();
+    if (anyOver) {
+      // Render the OVER layers onto a transparent scratch sprite and keep only the opaque runs
+      TFT_eSprite scratch(_tft);
+      scratch.setColorDepth(8);
+      if (!scratch.createSprite(w, h)) return false;
+      scratch.fillSprite(TFT_TRANSPARENT);
+      drawLayers(scratch, OVER);
+      const uint8_t key = scratch.color16to8(TFT_TRANSPARENT);
+      const uint8_t *px = (const uint8_t *)scratch.getPointer();
+      for (int16_t y = 0; y < h; y++) {
+        int16_t x = 0;
+        while (x < w) {
+          while (x < w && px[y * w + x] == key) x++;
+          int16_t start = x;
+          while (x < w && px[y * w + x] != key) x++;
+          if (x > start) {
+            OverSpan s = { y, start, (uint16_t)(x - start), (uint32_t)_overPixels.size() };
+            _overPixels.insert(_overPixels.end(), px + y * w + start, px + y * w + x);
+            _overSpans.push_back(s);
+          }
+        }
+      }
+      scratch.deleteSprite();
+    }
+    _stale = false;
+    return true;
+  }
+
+  TFT_eSPI *_tft;
+  TFT_eSprite _under;
+  uint16_t _background;
+  const RoundMask *_visible;
+  int16_t _w = 0, _h = 0;
+  Layer _layers[MAX_LAYERS];
+  uint8_t _layerCount = 0;
+  bool _stale = true;
+  std::vector<OverSpan> _overSpans;
+  std::vector<uint8_t> _overPixels;
+};
@@ -0,0 +1,182 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <map_tiles_data.h>
+
+// Runtime reader for the tiled map in map_tiles_data.h (see tools/map_tiles.py).
+// Tiles are MAP_TILE_SIZE square with pixels packed MSB first: 1 bit per pixel
+// at full resolution (level 0), 2-bit coverage in the reduced levels. Decoded
+// tiles are kept in a small LRU cache so a viewport only pays for the tiles
+// that scrolled into view.
+// Level 1 is not stored (its index is null): each of its tiles is box filtered
+// from the four level-0 tiles it covers as it is decoded, which costs four
+// level-0 decodes and a table lookup per output byte.
+
+namespace maptiles {
+
+// largest decoded tile row / tile of any level
+const uint16_t MAX_ROW_BYTES = MAP_TILE_SIZE * MAP_MAX_BPP / 8;
+const uint16_t MAX_TILE_BYTES = MAX_ROW_BYTES * MAP_TILE_SIZE;
+
+inline uint16_t rowBytes(const MapLevel &level) { return MAP_TILE_SIZE * level.bpp / 8; }
+inline uint16_t tileBytes(const MapLevel &level) { return rowBytes(level) * MAP_TILE_SIZE; }
+
+// Decode one LZ4 block. Returns false on malformed input instead of overrunning.
+inline bool lz4Decode(const uint8_t *src, uint32_t srcLen, uint8_t *dst, uint32_t dstLen) {
+  const uint8_t *const srcEnd = src + srcLen;
+  uint8_t *out = dst;
+  uint8_t *const outEnd = dst + dstLen;
+  while (src < srcEnd) {
+    const uint8_t token = *src++;
+    uint32_t lit = token >> 4;
+    if (lit == 15) {
+      uint8_t b;
+      do {
+        if (src >= srcEnd) return false;
+        b = *src++;
+        lit += b;
+      } while (b == 255);
+    }
+    if (lit > (uint32_t)(srcEnd - src) || lit > (uint32_t)(outEnd - out)) return false;
+    memcpy(out, src, lit);
+    out += lit;
+    src += lit;
+    if (src >= srcEnd) break; // last sequence has no match
+
+    if (srcEnd - src < 2) return false;
+    const uint16_t offset = src[0] | (src[1] << 8);
+    src += 2;
+    uint32_t len = (token & 15) + 4;
+    if ((token & 15) == 15) {
+      uint8_t b;
+      do {
+        if (src >= srcEnd) return false;
+        b = *src++;
+        len += b;
+      } while (b == 255);
+    }
+    if (offset == 0 || offset > (uint32_t)(out - dst) || len > (uint32_t)(outEnd - out)) return false;
+    const uint8_t *from = out - offset;
+    while (len--) *out++ = *from++; // may overlap, so byte by byte
+  }
+  return out == outEnd;
+}
+
+inline bool tileInMap(uint8_t level, int32_t tx, int32_t ty) {
+  return level < MAP_LEVELS && tx >= 0 && ty >= 0 && tx < mapLevels[level].tilesX && ty < mapLevels[level].tilesY;
+}
+
+// Two 2x2 boxes from a nibble of each of two map rows: their set pixels,
+// quantised to 2 bits rounding down as tools/map_tiles.py does, in one nibble
+struct HalveTable {
+  uint8_t q[256]; // [upper row nibble << 4 | lower row nibble]
+
+  constexpr HalveTable() : q() {
+    for (int i = 0; i < 256; i++) {
+      uint8_t v = 0;
+      for (int box = 0; box < 2; box++) {
+        const int shift = 2 - 2 * box;
+        const int bits = ((i >> 4) >> shift & 3) | ((i & 15) >> shift & 3) << 2;
+        const int count = (bits & 1) + (bits >> 1 & 1) + (bits >> 2 & 1) + (bits >> 3 & 1);
+        v |= (uint8_t)(3 * count / 4) << shift;
+      }
+      q[i] = v;
+    }
+  }
+};
+
+constexpr HalveTable halveTable;
+
+inline bool decodeTile(uint8_t level, uint16_t tx, uint16_t ty, uint8_t *out);
+
+// Tile (tx, ty) of level 1 from level-0 tiles (2tx..2tx+1, 2ty..2ty+1). Source
+// pixels past the map's right edge are masked off, since the bitmap's row
+// padding is stored in the level-0 tiles.
+inline bool deriveHalfTile(uint16_t tx, uint16_t ty, uint8_t *out) {
+  const uint16_t srcRow = MAP_TILE_SIZE / 8, outRow = MAP_TILE_SIZE / 4;
+  uint8_t src[MAP_TILE_SIZE * MAP_TILE_SIZE / 8];
+  for (uint8_t q = 0; q < 4; q++) {
+    const uint16_t sx = 2 * tx + (q & 1), sy = 2 * ty + (q >> 1);
+    uint8_t *dst = out + (q >> 1) * (MAP_TILE_SIZE / 2) * outRow + (q & 1) * srcRow;
+    if (!tileInMap(0, sx, sy)) {
+      for (uint8_t y = 0; y < MAP_TILE_SIZE / 2; y++) memset(dst + y * outRow, 0, srcRow);
+      continue;
+    }
+    if (!decodeTile(0, sx, sy, src)) return false;
+    uint8_t mask[MAP_TILE_SIZE / 8];
+    for (uint8_t b = 0; b < srcRow; b++) {
+      const int32_t left = MAP_WIDTH - (sx * MAP_TILE_SIZE + 8 * b); // map pixels left in this byte
+      mask[b] = left >= 8 ? 0xFF : left <= 0 ? 0 : (uint8_t)(0xFF << (8 - left));
+    }
+    for (uint8_t y = 0; y < MAP_TILE_SIZE / 2; y++) {
+      const uint8_t *a = src + 2 * y * srcRow;
+      const uint8_t *b = a + srcRow;
+      uint8_t *o = dst + y * outRow;
+      for (uint8_t i = 0; i < srcRow; i++) {
+        const uint8_t hi = a[i] & mask[i], lo = b[i] & mask[i];
+        o[i] = (uint8_t)(halveTable.q[(hi & 0xF0) | lo >> 4] << 4 | halveTable.q[(hi & 0x0F) << 4 | (lo & 0x0F)]);
+      }
+    }
+  }
+  return true;
+}
+
+// Decode tile (tx, ty) of a level into out[tileBytes(level)]
+inline bool decodeTile(uint8_t level, uint16_t tx, uint16_t ty, uint8_t *out) {
+  if (!tileInMap(level, tx, ty)) return false;
+  const MapLevel &l = mapLevels[level];
+  if (!l.index) return level == 1 && deriveHalfTile(tx, ty, out);
+  const uint32_t n = (uint32_t)ty * l.tilesX + tx;
+  const uint32_t entry = l.index[n];
+  const uint32_t start = entry & ~MAP_TILE_RAW;
+  const uint32_t end = l.index[n + 1] & ~MAP_TILE_RAW;
+  if (entry & MAP_TILE_RAW) {
+    memcpy(out, l.data + start, tileBytes(l));
+    return true;
+  }
+  return lz4Decode(l.data + start, end - start, out, tileBytes(l));
+}
+
+// Small LRU cache of decoded tiles, shared by all levels
+template <uint8_t SLOTS>
+class TileCache {
+public:
+  TileCache() {
+    for (uint8_t i = 0; i < SLOTS; i++) {
+      _key[i] = -1;
+      _used[i] = 0;
+    }
+  }
+
+  // Decoded tile, or nullptr outside the map / on a corrupt tile
+  const uint8_t *get(uint8_t level, int32_t tx, int32_t ty) {
+    if (!tileInMap(level, tx, ty)) return nullptr;
+    // the generator keeps every level under 4096 tiles
+    const int16_t key = (int16_t)((level << 12) | (ty * mapLevels[level].tilesX + tx));
+    _clock++;
+    uint8_t victim = 0;
+    for (uint8_t i = 0; i < SLOTS; i++) {
+      if (_key[i] == key) {
+        _used[i] = _clock;
+        return _tiles[i];
+      }
+      if (_used[i] < _used[victim]) victim = i;
+    }
+    if (!decodeTile(level, tx, ty, _tiles[victim])) {
+      _key[victim] = -1;
+      _used[victim] = 0;
+      return nullptr;
+    }
+    _key[victim] = key;
+    _used[victim] = _clock;
+    return _tiles[victim];
+  }
+
+private:
+  uint8_t _tiles[SLOTS][MAX_TILE_BYTES];
+  int16_t _key[SLOTS];
+  uint32_t _used[SLOTS];
+  uint32_t _clock = 0;
+};
+
+} // namespace maptiles
@@ -0,0 +1,287 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <map_tiles.h>
+#include <round_mask.h>
+#include <sprite_spans.h>
+#include <trig_utils.h>
+
+// Draws a window of the tiled map into an 8-bit or 4-bit sprite, centred on a map
+// position, clipped to the round panel. Work per frame is bounded by the
+// screen area: each output row gathers the few tile rows it crosses into a
+// line buffer, then expands whole source bytes to 8 (or 4) pixels at a time
+// through a 256-entry lookup table. Unaligned windows are realigned with one
+// shift per byte, so there is no per-pixel bit addressing at 1:1.
+// Zoomed-out views read one of the reduced map levels instead of downsampling,
+// so they cost the same as 1:1.
+// Heading-up views rotate the map about the centre. The round panel shows the
+// same source disc whatever the angle, so one tile-aligned block around it is
+// gathered per frame and every output row is walked with a fixed-point DDA:
+// two adds per pixel, no trig or multiplies inside the row.
+// 4-bit targets are drawn a row at a time into a byte-per-pixel scratch row,
+// which is then packed two pixels per byte into the sprite.
+
+struct MapView {
+  int32_t centerX; // full resolution map pixel at the centre of the panel
+  int32_t centerY;
+  int8_t zoom;     // > 0: each map pixel becomes 2^zoom screen pixels, < 0: map level -zoom at 1:1
+  int16_t heading; // degrees clockwise from north that point up on the panel, 0 draws north up
+};
+
+// How the 2-bit coverage of the reduced levels is drawn
+enum MapShading : uint8_t {
+  MAP_GREY, // four steps from bg to fg
+  MAP_MONO, // fg from half coverage up
+};
+
+template <uint8_t CACHE_SLOTS>
+class MapRenderer {
+public:
+  static const int8_t MAX_ZOOM = 3;
+  static const int8_t MIN_ZOOM = -(MAP_LEVELS - 1);
+  static const int16_t MAX_SIZE = 240; // largest panel the line and block buffers are sized for
+
+  MapRenderer(maptiles::TileCache<CACHE_SLOTS> &tiles) : _tiles(tiles) {}
+
+  // Set bits (or coverage) of the map draw in fg, clear bits and anything off the map in bg.
+  // fg and bg are RGB332 on an 8-bit target and palette indices on a 4-bit one, where
+  // the grey steps of MAP_GREY are the indices between bg and fg.
+  void render(SpanTarget &dst, const MapView &view, uint8_t fg, uint8_t bg, MapShading shading = MAP_GREY) {
+    const int8_t zoom = view.zoom > MAX_ZOOM ? MAX_ZOOM : view.zoom < MIN_ZOOM ? MIN_ZOOM : view.zoom;
+    const uint8_t level = zoom < 0 ? -zoom : 0;
+    const uint8_t mag = zoom > 0 ? zoom : 0;
+    const uint8_t bpp = mapLevels[level].bpp;
+    const bool packed = dst.bpp == 4;
+    if (fg != _fg || bg != _bg || bpp != _bpp || shading != _shading || packed != _packed) {
+      buildLut(fg, bg, bpp, shading, packed);
+    }
+    if (view.heading % 360 != 0) {
+      renderRotated(dst, view, level, mag);
+      if (dst.dirty) dst.dirty->addAll();
+      return;
+    }
+    // level position of screen pixel (0, 0); screen x maps to left + (x >> mag)
+    const int32_t left = (view.centerX >> level) - ((dst.w / 2) >> mag);
+    const int32_t top = (view.centerY >> level) - ((dst.h / 2) >> mag);
+
+    int32_t lastSrcRow = INT32_MIN;
+    int32_t lastY = -1, lastX0 = 0, lastX1 = -1;
+    for (int32_t y = 0; y < dst.h; y++) {
+      // visible span of this row on the round panel
+      int32_t x0, x1;
+      roundSpan(dst.w, dst.h, y, x0, x1);
+      if (x1 < x0) continue;
+
+      uint8_t *row = packed ? _scratch : dst.buf + y * dst.stride;
+      const int32_t my = top + (y >> mag);
+      if (my == lastSrcRow && lastY == y - 1 && x0 >= lastX0 && x1 <= lastX1) {
+        // same source row as the row above (zoomed in): copy it, the scratch row still has it
+        if (!packed) memcpy(row + x0, row - dst.stride + x0, x1 - x0 + 1);
+      } else {
+        renderRow(row, x0, x1, left, my, level, mag);
+      }
+      if (packed) packRow(dst.buf + y * dst.stride, x0, x1);
+      lastSrcRow = my;
+      lastY = y;
+      lastX0 = x0;
+      lastX1 = x1;
+    }
+    if (dst.dirty) dst.dirty->addAll();
+  }
+
+private:
+  // source pixels of margin around the rotated disc, for rounding at its edge
+  static const int32_t BLOCK_MARGIN = 2;
+  static const int32_t BLOCK_TILES = 5; // MAX_SIZE / 2 + BLOCK_MARGIN either side spans at most 5 tiles
+  static const int32_t BLOCK_STRIDE = BLOCK_TILES * maptiles::MAX_ROW_BYTES;
+  static const int32_t BLOCK_ROWS = 2 * (MAX_SIZE / 2 + BLOCK_MARGIN) + 1;
+
+  void renderRotated(SpanTarget &dst, const MapView &view, uint8_t level, uint8_t mag) {
+    const int32_t r = dst.w / 2;
+    const int32_t reach = (r >> mag) + BLOCK_MARGIN;
+    // panel centre in level pixels, Q16, on the same pixel as the north-up path
+    const int32_t cu = (view.centerX >> level) * 65536;
+    const int32_t cv = (view.centerY >> level) * 65536;
+    const int32_t blockLeft = floorDiv((cu >> 16) - reach, MAP_TILE_SIZE) * MAP_TILE_SIZE;
+    const int32_t blockTop = (cv >> 16) - reach;
+    gatherBlock(blockLeft, blockTop, 2 * reach + 1, level);
+
+    // source step per screen pixel along a row (du, dv), Q16
+    const int32_t du = (trig::cosQ15(view.heading) * 2) >> mag;
+    const int32_t dv = (trig::sinQ15(view.heading) * 2) >> mag;
+    const int32_t u0 = cu - blockLeft * 65536;
+    const int32_t v0 = cv - blockTop * 65536;
+    for (int32_t y = 0; y < dst.h; y++) {
+      int32_t x0, x1;
+      roundSpan(dst.w, dst.h, y, x0, x1);
+      if (x1 < x0) continue;
+      const int32_t dy = 2 * y + 1 - dst.h;
+      // pixel centre (x0 + 0.5, y + 0.5) relative to the panel centre is (dx, dy) / 2
+      const int32_t dx = 2 * x0 + 1 - dst.w;
+      const int32_t u = u0 + (dx * du - dy * dv) / 2;
+      const int32_t v = v0 + (dx * dv + dy * du) / 2;
+      uint8_t *out = (dst.bpp == 4 ? _scratch : dst.buf + y * dst.stride) + x0;
+      if (_bpp == 1) sampleRow<1>(out, x1 - x0 + 1, u, v, du, dv);
+      else sampleRow<2>(out, x1 - x0 + 1, u, v, du, dv);
+      if (dst.bpp == 4) packRow(dst.buf + y * dst.stride, x0, x1);
+    }
+  }
+
+  template <uint8_t BPP>
+  void sampleRow(uint8_t *out, int32_t n, int32_t u, int32_t v, int32_t du, int32_t dv) {
+    const int32_t perByteShift = BPP == 1 ? 3 : 2;
+    const int32_t pixelMask = (8 / BPP) - 1;
+    while (n--) {
+      const int32_t px = u >> 16;
+      const uint8_t b = _block[(v >> 16) * BLOCK_STRIDE + (px >> perByteShift)];
+      *out++ = _shade[(b >> (8 - BPP - (px & pixelMask) * BPP)) & ((1 << BPP) - 1)];
+      u += du;
+      v += dv;
+    }
+  }
+
+  // Copy rows top..top + rows - 1 of BLOCK_TILES tiles from level x left into _block,
+  // one tile at a time so each tile is fetched once per frame
+  void gatherBlock(int32_t left, int32_t top, int32_t rows, uint8_t level) {
+    const uint16_t rowBytes = maptiles::rowBytes(mapLevels[level]);
+    const int32_t tx0 = floorDiv(left, MAP_TILE_SIZE);
+    const int32_t bottom = top + rows - 1;
+    for (int32_t ty = floorDiv(top, MAP_TILE_SIZE); ty <= floorDiv(bottom, MAP_TILE_SIZE); ty++) {
+      const int32_t y0 = top > ty * MAP_TILE_SIZE ? top : ty * MAP_TILE_SIZE;
+      const int32_t y1 = bottom < ty * MAP_TILE_SIZE + MAP_TILE_SIZE - 1 ? bottom : ty * MAP_TILE_SIZE + MAP_TILE_SIZE - 1;
+      for (int32_t i = 0; i < BLOCK_TILES; i++) {
+        const uint8_t *tile = _tiles.get(level, tx0 + i, ty);
+        uint8_t *out = _block + (y0 - top) * BLOCK_STRIDE + i * rowBytes;
+        for (int32_t y = y0; y <= y1; y++) {
+          if (tile) memcpy(out, tile + (y - ty * MAP_TILE_SIZE) * rowBytes, rowBytes);
+          else memset(out, 0, rowBytes);
+          out += BLOCK_STRIDE;
+        }
+      }
+    }
+  }
+
+  // Screen x0..x1 of one output row from row my of a map level
+  void renderRow(uint8_t *row, int32_t x0, int32_t x1, int32_t left, int32_t my, uint8_t level, uint8_t mag) {
+    if (my < 0 || my >= mapLevels[level].height) {
+      memset(row + x0, _shade[0], x1 - x0 + 1);
+      return;
+    }
+    const int32_t mx0 = left + (x0 >> mag);
+    const int32_t mx1 = left + (x1 >> mag);
+    const int32_t pxBase = gatherRow(mx0, mx1, my, level); // level x of the first pixel in _line
+    const int32_t bpp = _bpp;
+
+    if (mag == 0) {
+      // 1:1, expand a whole source byte at a time
+      const int32_t perByte = 8 / bpp;
+      const int32_t shift = ((mx0 - pxBase) % perByte) * bpp;
+      const uint8_t *src = _line + (mx0 - pxBase) / perByte;
+      uint8_t *out = row + x0;
+      int32_t n = x1 - x0 + 1;
+      while (n >= perByte) {
+        const uint8_t b = shift ? (uint8_t)((src[0] << shift) | (src[1] >> (8 - shift))) : src[0];
+        memcpy(out, _lut[b], perByte);
+        out += perByte;
+        n -= perByte;
+        src++;
+      }
+      if (n > 0) {
+        const uint8_t b = shift ? (uint8_t)((src[0] << shift) | (src[1] >> (8 - shift))) : src[0];
+        memcpy(out, _lut[b], n);
+      }
+      return;
+    }
+
+    // zoomed in: every source pixel fills a run of 2^mag screen pixels
+    const int32_t scale = 1 << mag;
+    const uint8_t mask = (1 << bpp) - 1;
+    int32_t x = x0;
+    while (x <= x1) {
+      const int32_t mx = left + (x >> mag);
+      const int32_t bit = (mx - pxBase) * bpp;
+      const uint8_t v = (_line[bit >> 3] >> (8 - bpp - (bit & 7))) & mask;
+      int32_t runEnd = ((x >> mag) + 1) * scale - 1;
+      if (runEnd > x1) runEnd = x1;
+      memset(row + x, _shade[v], runEnd - x + 1);
+      x = runEnd + 1;
+    }
+  }
+
+  // Copy row my, columns mx0..mx1 of a level into _line starting at a tile boundary.
+  // Returns the level x of the first pixel in _line.
+  int32_t gatherRow(int32_t mx0, int32_t mx1, int32_t my, uint8_t level) {
+    const uint16_t rowBytes = maptiles::rowBytes(mapLevels[level]);
+    const int32_t tx0 = floorDiv(mx0, MAP_TILE_SIZE);
+    const int32_t tx1 = floorDiv(mx1, MAP_TILE_SIZE);
+    const int32_t ty = my / MAP_TILE_SIZE;
+    const int32_t rowInTile = my % MAP_TILE_SIZE;
+    uint8_t *out = _line;
+    for (int32_t tx = tx0; tx <= tx1 && out + rowBytes < _line + sizeof(_line); tx++) {
+      const uint8_t *tile = _tiles.get(level, tx, ty);
+      if (tile) memcpy(out, tile + rowInTile * rowBytes, rowBytes);
+      else memset(out, 0, rowBytes);
+      out += rowBytes;
+    }
+    *out = 0; // realignment reads one byte past the end
+    return tx0 * MAP_TILE_SIZE;
+  }
+
+  // Scratch pixels x0..x1 into a 4-bit row, even x in the high nibble
+  void packRow(uint8_t *out, int32_t x0, int32_t x1) {
+    int32_t x = x0;
+    if (x & 1) {
+      out[x >> 1] = (out[x >> 1] & 0xF0) | _scratch[x];
+      x++;
+    }
+    for (; x < x1; x += 2) out[x >> 1] = (uint8_t)((_scratch[x] << 4) | _scratch[x + 1]);
+    if (x == x1) out[x >> 1] = (uint8_t)((_scratch[x] << 4) | (out[x >> 1] & 0x0F));
+  }
+
+  static int32_t floorDiv(int32_t a, int32_t b) { return a >= 0 ? a / b : -((-a + b - 1) / b); }
+
+  // RGB332 colour t/3 of the way from bg to fg
+  static uint8_t blend332(uint8_t bg, uint8_t fg, uint8_t t) {
+    const int32_t r = ((bg >> 5) * (3 - t) + (fg >> 5) * t + 1) / 3;
+    const int32_t g = (((bg >> 2) & 7) * (3 - t) + ((fg >> 2) & 7) * t + 1) / 3;
+    const int32_t b = ((bg & 3) * (3 - t) + (fg & 3) * t + 1) / 3;
+    return (uint8_t)((r << 5) | (g << 2) | b);
+  }
+
+  void buildLut(uint8_t fg, uint8_t bg, uint8_t bpp, MapShading shading, bool packed) {
+    if (bpp == 1) {
+      _shade[0] = bg;
+      _shade[1] = fg;
+    } else {
+      for (uint8_t v = 0; v < 4; v++) {
+        if (shading == MAP_MONO) _shade[v] = v >= 2 ? fg : bg;
+        else if (packed) _shade[v] = (uint8_t)(bg + ((fg - bg) * v) / 3);
+        else _shade[v] = blend332(bg, fg, v);
+      }
+    }
+    const uint8_t perByte = 8 / bpp;
+    const uint8_t mask = (1 << bpp) - 1;
+    for (int b = 0; b < 256; b++) {
+      for (uint8_t i = 0; i < perByte; i++) _lut[b][i] = _shade[(b >> (8 - bpp * (i + 1))) & mask];
+    }
+    _fg = fg;
+    _bg = bg;
+    _bpp = bpp;
+    _shading = shading;
+    _packed = packed;
+  }
+
+  maptiles::TileCache<CACHE_SLOTS> &_tiles;
+  uint8_t _lut[256][8];
+  uint8_t _shade[4];
+  // a 240 px row spans at most 5 tiles of 64 px, plus one guard byte
+  uint8_t _line[6 * maptiles::MAX_ROW_BYTES + 1];
+  // source disc of a rotated frame
+  uint8_t _block[BLOCK_ROWS * BLOCK_STRIDE];
+  // one output row of a 4-bit target before packing
+  uint8_t _scratch[MAX_SIZE];
+  uint8_t _fg = 0, _bg = 0;
+  uint8_t _bpp = 0; // 0 until the first buildLut
+  MapShading _shading = MAP_GREY;
+  bool _packed = false;
+};
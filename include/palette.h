@@ -0,0 +1,98 @@
+#pragma once
+#include <stdint.h>
+
+// Colours of the screens, built at compile time in both formats the code
+// needs: RGB565 for TFT_eSPI calls that take a 16-bit colour, and the 8-bit
+// sprites' RGB332 for the span renderers, which write sprite memory directly.
+// to332() matches TFT_eSPI's color16to8(), so a pair always shows the same
+// colour whichever way it reaches the sprite.
+
+namespace palette {
+
+constexpr uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b) {
+  return (uint16_t)(((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3));
+}
+
+constexpr uint8_t to332(uint16_t c) {
+  return (uint8_t)(((c & 0xE000) >> 8) | ((c & 0x0700) >> 6) | ((c & 0x0018) >> 3));
+}
+
+struct Colour {
+  uint16_t c565;
+  uint8_t c332;
+  constexpr Colour(uint8_t r, uint8_t g, uint8_t b) : c565(rgb565(r, g, b)), c332(to332(rgb565(r, g, b))) {}
+};
+
+// Screen 0
+constexpr Colour BACKGROUND(0, 0, 0);
+constexpr Colour NEEDLE(255, 0, 0);
+constexpr Colour COMPASS_NORTH(255, 0, 0);
+constexpr Colour COMPASS_OTHER(255, 180, 0);
+constexpr Colour TICK(255, 255, 255);
+constexpr Colour BOOST_LOW(255, 255, 255);
+constexpr Colour BOOST_MID(255, 255, 0);
+constexpr Colour BOOST_HIGH(255, 0, 0);
+constexpr Colour SCOOTER(255, 255, 255);
+
+// Screen 1
+constexpr Colour MAP_FG(255, 255, 255);
+constexpr Colour MAP_BG(0, 0, 0);
+constexpr Colour RIDER(255, 0, 0);
+
+// Screen 1 uses a 4-bit palettised sprite: these are its palette indices, with
+// the map's grey steps between MAP_INDEX_BG and MAP_INDEX_FG (see MapRenderer)
+enum Screen1Index : uint8_t { MAP_INDEX_BG, MAP_INDEX_DARK, MAP_INDEX_LIGHT, MAP_INDEX_FG, RIDER_INDEX };
+
+// RGB565 colour t/3 of the way from a to b
+constexpr uint16_t blend565(uint16_t a, uint16_t b, uint8_t t) {
+  return (uint16_t)(((((a >> 11) * (3 - t) + (b >> 11) * t + 1) / 3) << 11) |
+                    (((((a >> 5) & 0x3F) * (3 - t) + ((b >> 5) & 0x3F) * t + 1) / 3) << 5) |
+                    (((a & 0x1F) * (3 - t) + (b & 0x1F) * t + 1) / 3));
+}
+
+constexpr uint16_t screen1Palette[16] = {
+  MAP_BG.c565, blend565(MAP_BG.c565, MAP_FG.c565, 1), blend565(MAP_BG.c565, MAP_FG.c565, 2), MAP_FG.c565,
+  RIDER.c565,
+};
+
+// Shock gradient: green at 0% to red at 100%, one entry per percent
+// (red = pct * 255 / 100, green = 255 - red, as the old per-frame map() gave)
+const uint8_t SHOCK_STEPS = 101;
+
+struct ShockRamp {
+  uint16_t c565[SHOCK_STEPS];
+  uint8_t c332[SHOCK_STEPS];
+  constexpr ShockRamp() : c565(), c332() {
+    for (uint8_t pct = 0; pct < SHOCK_STEPS; pct++) {
+      const uint8_t r = (uint8_t)(pct * 255 / 100);
+      c565[pct] = rgb565(r, 255 - r, 0);
+      c332[pct] = to332(c565[pct]);
+    }
+  }
+};
+
+constexpr ShockRamp shockRamp{};
+
+inline uint8_t clampPct(int pct) { return pct < 0 ? 0 : pct > 100 ? 100 : (uint8_t)pct; }
+inline uint16_t shock565(int pct) { return shockRamp.c565[clampPct(pct)]; }
+inline uint8_t shock332(int pct) { return shockRamp.c332[clampPct(pct)]; }
+
+// The ramp runs from pure green to pure red, with red never falling and green
+// never rising, in both formats
+constexpr bool rampMonotonic() {
+  for (uint8_t i = 1; i < SHOCK_STEPS; i++) {
+    if ((shockRamp.c565[i] >> 11) < (shockRamp.c565[i - 1] >> 11)) return false;
+    if (((shockRamp.c565[i] >> 5) & 0x3F) > ((shockRamp.c565[i - 1] >> 5) & 0x3F)) return false;
+    if ((shockRamp.c332[i] >> 5) < (shockRamp.c332[i - 1] >> 5)) return false;
+    if (((shockRamp.c332[i] >> 2) & 0x07) > ((shockRamp.c332[i - 1] >> 2) & 0x07)) return false;
+    if (shockRamp.c565[i] & 0x1F || shockRamp.c332[i] & 0x03) return false;
+  }
+  return true;
+}
+
+static_assert(shockRamp.c565[0] == 0x07E0 && shockRamp.c565[SHOCK_STEPS - 1] == 0xF800, "shock ramp ends");
+static_assert(shockRamp.c332[0] == 0x1C && shockRamp.c332[SHOCK_STEPS - 1] == 0xE0, "shock ramp ends");
+static_assert(rampMonotonic(), "shock ramp must run green to red monotonically");
+static_assert(COMPASS_OTHER.c565 == 0xFDA0, "orange as TFT_ORANGE");
+
+} // namespace palette
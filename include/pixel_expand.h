@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+
+// Sprite pixels to the byte-swapped RGB565 the panels take, for the push path.
+// 8-bit sprites go through a 256-entry table of single pixels. 4-bit sprites
+// hold two palette indices per byte (even x in the high nibble, as TFT_eSprite
+// stores them), so their table maps a whole byte to both pixels at once: one
+// lookup and one 32-bit store per pair, and half the sprite memory to read.
+
+namespace pixels {
+
+inline uint16_t swap565(uint16_t c) { return (uint16_t)((c << 8) | (c >> 8)); }
+
+// Both pixels of every 4-bit byte, first (high nibble) pixel in the low half so
+// it lands first in memory
+inline void buildPairLut(uint32_t pairs[256], const uint16_t palette[16]) {
+  for (int b = 0; b < 256; b++) {
+    pairs[b] = swap565(palette[b >> 4]) | ((uint32_t)swap565(palette[b & 0x0F]) << 16);
+  }
+}
+
+inline void expand8(const uint8_t *src, uint16_t *out, uint32_t n, const uint16_t lut[256]) {
+  while (n--) *out++ = lut[*src++];
+}
+
+// 2 * bytes pixels; out must be 4-byte aligned
+inline void expand4(const uint8_t *src, uint16_t *out, uint32_t bytes, const uint32_t pairs[256]) {
+  uint32_t *o = (uint32_t *)out;
+  while (bytes--) *o++ = pairs[*src++];
+}
+
+} // namespace pixels
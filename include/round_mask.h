@@ -0,0 +1,56 @@
+#pragma once
+#include <stdint.h>
+#include <trig_utils.h>
+
+// Visible area of the round GC9A01 panels. Row y of the square frame shows
+// pixels x0[y]..x1[y] only; the corners, ~21% of the frame, are never seen.
+// The table is built at compile time with the rounding the map renderer has
+// always clipped with, so clears, span rasterizers and pushes agree on the edge.
+
+const int16_t ROUND_SIZE = 240;
+
+struct RoundMask {
+  int16_t x0[ROUND_SIZE];
+  int16_t x1[ROUND_SIZE]; // x1 < x0 where a row shows nothing
+
+  constexpr RoundMask() : x0(), x1() {
+    const int32_t r = ROUND_SIZE / 2;
+    for (int32_t y = 0; y < ROUND_SIZE; y++) {
+      const int32_t dy = 2 * y + 1 - ROUND_SIZE;
+      const int32_t half = trig::isqrt(r * r * 4 - dy * dy) / 2;
+      x0[y] = (int16_t)(r - half);
+      x1[y] = (int16_t)(r + half - 1);
+    }
+  }
+
+  // Narrow a..b of row y to the visible part, false if none of it is
+  inline bool clip(int32_t y, int32_t &a, int32_t &b) const {
+    if (y < 0 || y >= ROUND_SIZE) return false;
+    if (a < x0[y]) a = x0[y];
+    if (b > x1[y]) b = x1[y];
+    return a <= b;
+  }
+
+  constexpr uint32_t visiblePixels() const {
+    uint32_t n = 0;
+    for (int16_t y = 0; y < ROUND_SIZE; y++) n += x1[y] >= x0[y] ? x1[y] - x0[y] + 1 : 0;
+    return n;
+  }
+};
+
+constexpr RoundMask roundMask{};
+
+// Visible span of row y in a w x h frame clipped to its inscribed circle: the
+// table for panel-sized frames, computed the same way for any other size
+inline void roundSpan(int16_t w, int16_t h, int32_t y, int32_t &x0, int32_t &x1) {
+  if (w == ROUND_SIZE && h == ROUND_SIZE) {
+    x0 = roundMask.x0[y];
+    x1 = roundMask.x1[y];
+    return;
+  }
+  const int32_t r = w / 2;
+  const int32_t dy = 2 * y + 1 - h;
+  const int32_t half = trig::isqrt(r * r * 4 - dy * dy) / 2;
+  x0 = r - half;
+  x1 = r + half - 1;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include <TFT_eSPI.h>
+#include <dirty_rects.h>
+#include <layer_cache.h>
+#include <map_tiles.h>
+#include <map_view.h>
+#include <palette.h>
+#include <shock_noise.h>
+
+// Screen renderers, kept apart from setup()/loop() and the BLE code so the
+// native build (env:native, see src/host/) can run them against the software
+// TFT backend.
+
+//Create TFT Colors
+#define TFT_BLACK       0x0000      /*   0,   0,   0 */
+#define TFT_NAVY        0x000F      /*   0,   0, 128 */
+#define TFT_DARKGREEN   0x03E0      /*   0, 128,   0 */
+#define TFT_DARKCYAN    0x03EF      /*   0, 128, 128 */
+#define TFT_MAROON      0x7800      /* 128,   0,   0 */
+#define TFT_PURPLE      0x780F      /* 128,   0, 128 */
+#define TFT_OLIVE       0x7BE0      /* 128, 128,   0 */
+#define TFT_LIGHTGREY   0xC618      /* 192, 192, 192 */
+#define TFT_DARKGREY    0x7BEF      /* 128, 128, 128 */
+#define TFT_BLUE        0x001F      /*   0,   0, 255 */
+#define TFT_GREEN       0x07E0      /*   0, 255,   0 */
+#define TFT_CYAN        0x07FF      /*   0, 255, 255 */
+#define TFT_RED         0xF800      /* 255,   0,   0 */
+#define TFT_MAGENTA     0xF81F      /* 255,   0, 255 */
+#define TFT_YELLOW      0xFFE0      /* 255, 255,   0 */
+#define TFT_WHITE       0xFFFF      /* 255, 255, 255 */ 
+
+//Defined next to setup()/loop() (main.cpp, or src/host/ on the native build)
+extern TFT_eSPI tft;
+
+//Sensor Variables
+extern int shockSensorBackValue;
+extern int shockSensorFrontValue;
+extern int gForceValueX;
+extern int gForceValueZ;
+extern float tiltAngleValue;
+extern int compassValue; //From 0-360 degrees
+
+//Static layers of screen 0, rendered once and copied into img every frame
+extern LayerCache screen0Layers;
+
+//Map state for screen 1
+extern maptiles::TileCache<16> mapTiles;
+extern MapRenderer<16> mapRenderer;
+extern MapView mapView;
+extern bool mapHeadingUp;
+
+//Shock gradient noise (see shock_noise.h)
+extern shocknoise::Mode shockNoiseMode;
+extern uint32_t shockNoiseSeed;
+
+//Register and render the static layers of screen 0, once the panels are up
+bool prepareScreen0Layers();
+
+//Screen 0 draws into an 8-bit sprite, screen 1 into a 4-bit one using palette::screen1Palette
+void updateScreen0(TFT_eSprite &img, DirtyTracker &screen0Dirty);
+void updateScreen1(TFT_eSprite &img2, DirtyTracker &screen1Dirty);
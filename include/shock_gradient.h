@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include <sprite_spans.h>
+#include <shock_noise.h>
+
+// Direct-to-buffer renderer for the shock sensor gradient on screen 0.
+//
+// The gradient is two bands (back and front wheel) SHOCK_ROWS tall, mirrored
+// around cx. Cell (dx, dy) is lit when its noise threshold is below
+// pct / max(dx / 4, 1), and the same cells are lit in both bands and on both
+// sides. The lit cells are first collected into one bit mask per band row,
+// without branching on the noise. The set bits of each mask are then stored
+// straight into the sprite rows of both bands, mirrored, so a lit cell costs
+// four byte stores instead of four clipped drawPixel calls with a colour
+// conversion each.
+
+const uint8_t SHOCK_ROWS = 15;
+const uint8_t SHOCK_REACH = 89; // cells each side of the centre line
+const uint8_t SHOCK_WORDS = (SHOCK_REACH + 1 + 31) / 32;
+
+struct ShockGradient {
+  int16_t cx;        // mirror line
+  int16_t backY;     // top row of the back band
+  int16_t frontY;    // top row of the front band
+  uint8_t pct;       // 0..100, density of the lit cells
+  uint8_t backColor; // 8-bit sprite colours
+  uint8_t frontColor;
+};
+
+namespace shock_detail {
+
+// Writes every set bit x of lit at cx + x and cx - x
+inline void mirrorBits(uint8_t *row, int16_t cx, const uint32_t *lit, uint8_t color) {
+  for (uint8_t w = 0; w < SHOCK_WORDS; w++) {
+    uint32_t bits = lit[w];
+    while (bits) {
+      const int x = w * 32 + __builtin_ctz(bits);
+      row[cx + x] = color;
+      row[cx - x] = color;
+      bits &= bits - 1;
+    }
+  }
+}
+
+} // namespace shock_detail
+
+// Draws the gradient into an 8-bit t, or nothing if it does not fit inside the sprite.
+// Threshold sources that consume noise (XORSHIFT, LIBC_RAND) draw from rng / rand().
+inline void drawShockGradient(SpanTarget &t, const ShockGradient &g, shocknoise::Mode mode,
+                              shocknoise::XorShift32 &rng) {
+  if (t.bpp != 8) return;
+  if (g.cx - SHOCK_REACH < 0 || g.cx + SHOCK_REACH >= t.w) return;
+  if (g.backY < 0 || g.backY + SHOCK_ROWS > t.h || g.frontY < 0 || g.frontY + SHOCK_ROWS > t.h) return;
+  if (!g.pct) return;
+
+  uint32_t lit[SHOCK_ROWS][SHOCK_WORDS] = {};
+  uint8_t thresholds[SHOCK_ROWS];
+  for (int dx = 1; dx <= SHOCK_REACH; dx++) {
+    const int denom = dx / 4 ? dx / 4 : 1;
+    const int density = g.pct / denom;
+    if (!density) break; // density only falls further out
+    shocknoise::fillRow(mode, rng, dx, thresholds, SHOCK_ROWS);
+    const uint8_t word = dx >> 5, shift = dx & 31;
+    for (int dy = 0; dy < SHOCK_ROWS; dy++) {
+      lit[dy][word] |= (uint32_t)(thresholds[dy] < density) << shift; // no branch on noise
+    }
+  }
+
+  for (int dy = 0; dy < SHOCK_ROWS; dy++) {
+    shock_detail::mirrorBits(t.buf + (g.backY + dy) * t.stride, g.cx, lit[dy], g.backColor);
+    shock_detail::mirrorBits(t.buf + (g.frontY + dy) * t.stride, g.cx, lit[dy], g.frontColor);
+  }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <stdint.h>
+#include <stdlib.h>
+
+// Threshold sources for the shock sensor gradient on screen 0.
+// A gradient cell is lit when its threshold (0..RANGE-1) is below the cell's
+// density, so the source decides how the lit cells are spread:
+//  - DITHER: a 16x16 Bayer ordered-dither matrix, built at compile time. Stable
+//    from frame to frame, evenly spread, and just a table read per cell.
+//  - XORSHIFT: xorshift32 noise. Free running it flickers like rand(); with a
+//    non-zero seed it restarts every frame, so the output is reproducible.
+//  - LIBC_RAND: the original rand() % RANGE, kept for comparison.
+
+namespace shocknoise {
+
+const uint8_t RANGE = 80;
+const uint8_t MASK_SIZE = 16;
+
+enum Mode : uint8_t { DITHER, XORSHIFT, LIBC_RAND };
+
+// Bayer index of (x, y): the 2x2 pattern [[0, 2], [3, 1]] nested per bit,
+// lowest bits most significant
+constexpr uint8_t bayerIndex(uint8_t x, uint8_t y) {
+  uint8_t v = 0;
+  for (uint8_t bit = 0; bit < 4; bit++) {
+    const uint8_t xb = (x >> bit) & 1;
+    const uint8_t yb = (y >> bit) & 1;
+    const uint8_t q = yb ? (xb ? 1 : 3) : (xb ? 2 : 0);
+    v |= q << (2 * (3 - bit));
+  }
+  return v;
+}
+
+struct DitherMask {
+  uint8_t t[MASK_SIZE][MASK_SIZE];
+  constexpr DitherMask() : t() {
+    for (uint8_t y = 0; y < MASK_SIZE; y++) {
+      for (uint8_t x = 0; x < MASK_SIZE; x++) t[y][x] = (uint8_t)(bayerIndex(x, y) * RANGE / 256);
+    }
+  }
+};
+
+constexpr DitherMask ditherMask{};
+
+struct XorShift32 {
+  uint32_t state;
+
+  explicit XorShift32(uint32_t seed = 0x9E3779B9) : state(seed ? seed : 0x9E3779B9) {}
+
+  inline uint32_t next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+  // Uniform in 0..n-1 without a divide
+  inline uint8_t below(uint8_t n) { return (uint8_t)(((uint64_t)next() * n) >> 32); }
+};
+
+// Thresholds of cells 0..n-1 of one gradient row
+inline void fillRow(Mode mode, XorShift32 &rng, int row, uint8_t *out, int n) {
+  switch (mode) {
+    case DITHER: {
+      const uint8_t *mask = ditherMask.t[row & (MASK_SIZE - 1)];
+      for (int i = 0; i < n; i++) out[i] = mask[i & (MASK_SIZE - 1)];
+      break;
+    }
+    case XORSHIFT:
+      for (int i = 0; i < n; i++) out[i] = rng.below(RANGE);
+      break;
+    case LIBC_RAND:
+      for (int i = 0; i < n; i++) out[i] = (uint8_t)(rand() % RANGE);
+      break;
+  }
+}
+
+} // namespace shocknoise
@@ -0,0 +1,60 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <TFT_eSPI.h>
+#include <dirty_rects.h>
+#include <round_mask.h>
+
+// Raw view of a sprite's pixel buffer, so renderers can write whole
+// horizontal spans with memset instead of going through drawPixel.
+// 8-bit sprites hold one RGB332 byte per pixel; 4-bit sprites hold two
+// palette indices per byte, the even x in the high nibble.
+// If a dirty region is attached, every span written is reported to it; if a
+// round mask is, spans are clipped to the visible circle of the panel.
+struct SpanTarget {
+  uint8_t *buf;
+  int16_t w;
+  int16_t h;
+  DirtyRegion *dirty;
+  uint8_t bpp;    // 8 or 4
+  int16_t stride; // bytes per row
+  const RoundMask *visible;
+
+  // Fill pixels x0..x1 (inclusive) of row y, clipped to the sprite
+  inline void hspan(int32_t y, int32_t x0, int32_t x1, uint8_t color) {
+    if (y < 0 || y >= h) return;
+    if (x0 < 0) x0 = 0;
+    if (x1 >= w) x1 = w - 1;
+    if (visible && !visible->clip(y, x0, x1)) return;
+    if (x1 < x0) return;
+    if (bpp == 4) hspan4(buf + y * stride, x0, x1 + 1, color & 0x0F);
+    else memset(buf + y * stride + x0, color, x1 - x0 + 1);
+    if (dirty) dirty->add(x0, y, x1 - x0 + 1, 1);
+  }
+
+private:
+  // pixels x..end-1, odd ends go through a nibble read-modify-write
+  static inline void hspan4(uint8_t *row, int32_t x, int32_t end, uint8_t index) {
+    if (x & 1) {
+      row[x >> 1] = (row[x >> 1] & 0xF0) | index;
+      x++;
+    }
+    if (end > x && (end & 1)) {
+      end--;
+      row[end >> 1] = (uint8_t)((index << 4) | (row[end >> 1] & 0x0F));
+    }
+    if (end > x) memset(row + (x >> 1), index * 0x11, (end - x) >> 1);
+  }
+};
+
+// Pass &roundMask as visible for a panel-sized frame of a round panel
+inline SpanTarget spanTarget(TFT_eSprite &spr, DirtyRegion *dirty = nullptr, const RoundMask *visible = nullptr) {
+  const uint8_t bpp = spr.getColorDepth() == 4 ? 4 : 8;
+  const int16_t w = spr.width();
+  const int16_t h = spr.height();
+  if (w != ROUND_SIZE || h != ROUND_SIZE) visible = nullptr;
+  SpanTarget t = {
+    (uint8_t *)spr.getPointer(), w, h, dirty, bpp, (int16_t)(bpp == 4 ? (w + 1) / 2 : w), visible
+  };
+  return t;
+}
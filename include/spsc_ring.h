@@ -0,0 +1,115 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <type_traits>
+
+// Lock-free queue between exactly one producer and one consumer, e.g. the
+// NimBLE host task delivering notifications and the render loop reading them.
+// Neither side ever blocks or takes a lock. When the queue is full, push()
+// fails (and counts the drop), for items that must not be skipped silently;
+// pushOverwrite() drops the oldest item instead, for samples where only the
+// newest matters, so a consumer that stalled comes back to current data.
+// pop() fails when it is empty.
+//
+// The indices count up forever (N divides 2^32, so they wrap cleanly). The
+// producer only writes the head, and takes the tail from the consumer only to
+// drop the oldest item, with a compare-and-swap. The consumer copies an item
+// out and then claims it by moving the tail with a compare-and-swap, which
+// fails, and it copies again, if the producer dropped that item meanwhile.
+// Slots are stored as relaxed atomic words so a copy racing an overwrite is
+// only ever discarded, never undefined. N must be a power of two; all N fit.
+
+template <typename T, uint32_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "ring size must be a power of two");
+  static_assert(std::is_trivially_copyable<T>::value, "items are copied as words");
+
+public:
+  // Producer side: false (and the item counted as dropped) if the queue is full
+  bool push(const T &item) {
+    const uint32_t head = _head.load(std::memory_order_relaxed);
+    if (head - _tail.load(std::memory_order_acquire) == N) {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    store(head, item);
+    _head.store(head + 1, std::memory_order_release);
+    _pushed.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Producer side: always queues the item, dropping (and counting) the oldest
+  // one if the queue is full
+  void pushOverwrite(const T &item) {
+    const uint32_t head = _head.load(std::memory_order_relaxed);
+    uint32_t tail = _tail.load(std::memory_order_acquire);
+    // if this fails the consumer just took the oldest item, which made room
+    if (head - tail == N &&
+        _tail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    store(head, item);
+    _head.store(head + 1, std::memory_order_release);
+    _pushed.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Consumer side: oldest item
+  bool pop(T &out) {
+    uint32_t tail = _tail.load(std::memory_order_acquire);
+    do {
+      if (tail == _head.load(std::memory_order_acquire)) return false;
+      load(tail, out);
+    } while (!_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel, std::memory_order_acquire));
+    return true;
+  }
+
+  // Consumer side: empty the queue keeping only the newest item, false if
+  // nothing arrived since the last call
+  bool popLatest(T &out) {
+    uint32_t tail = _tail.load(std::memory_order_acquire);
+    uint32_t head;
+    do {
+      head = _head.load(std::memory_order_acquire);
+      if (tail == head) return false;
+      load(head - 1, out);
+    } while (!_tail.compare_exchange_weak(tail, head, std::memory_order_acq_rel, std::memory_order_acquire));
+    return true;
+  }
+
+  // Items waiting, a snapshot from either side
+  uint32_t size() const {
+    const uint32_t tail = _tail.load(std::memory_order_acquire);
+    const uint32_t n = _head.load(std::memory_order_acquire) - tail;
+    return n < N ? n : N;
+  }
+  static constexpr uint32_t capacity() { return N; }
+
+  // Totals since start, for stats: items queued, and items lost to push() on
+  // a full queue or overwritten by pushOverwrite()
+  uint32_t pushed() const { return _pushed.load(std::memory_order_relaxed); }
+  uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+
+private:
+  static const uint32_t WORDS = (sizeof(T) + 3) / 4;
+
+  void store(uint32_t index, const T &item) {
+    uint32_t w[WORDS] = {};
+    memcpy(w, &item, sizeof(T));
+    std::atomic<uint32_t> *slot = _slots[index & (N - 1)];
+    for (uint32_t i = 0; i < WORDS; i++) slot[i].store(w[i], std::memory_order_relaxed);
+  }
+
+  void load(uint32_t index, T &out) const {
+    uint32_t w[WORDS];
+    const std::atomic<uint32_t> *slot = _slots[index & (N - 1)];
+    for (uint32_t i = 0; i < WORDS; i++) w[i] = slot[i].load(std::memory_order_relaxed);
+    memcpy(&out, w, sizeof(T));
+  }
+
+  std::atomic<uint32_t> _slots[N][WORDS] = {};
+  std::atomic<uint32_t> _head{0}; // next item to write, producer only
+  std::atomic<uint32_t> _tail{0}; // next item to read, consumer (and producer dropping the oldest)
+  std::atomic<uint32_t> _pushed{0};
+  std::atomic<uint32_t> _dropped{0};
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary telemetry packet sent by the scooter controller on characteristic
+// 23680ff2-e66b-4a4e-a051-422d2665c443. All fields little-endian:
+//
+//   offset size  field
+//        0    1  magic, TELEMETRY_MAGIC
+//        1    1  version, major in the high nibble, minor in the low nibble
+//        2    1  length of the whole packet in bytes, CRC included
+//        3    2  sequence number, wraps
+//        5    2  speed, 0.01 km/h
+//        7    1  battery, percent
+//        8    2  motor temperature, 0.1 degC, signed
+//       10    2  CRC-16/CCITT-FALSE of bytes 0..length-3
+//
+// A newer minor version may add fields before the CRC; the decoder reads the
+// fields it knows and skips the rest. A different major version is rejected.
+// Decoding reads straight from the received buffer into a Telemetry, with no
+// allocation, so it is cheap enough to run in the BLE callback.
+
+const uint8_t TELEMETRY_MAGIC = 0xB5;
+const uint8_t TELEMETRY_VERSION = 0x10; // 1.0
+const uint8_t TELEMETRY_SIZE = 12;      // length of a version 1.0 packet
+
+struct Telemetry {
+  uint16_t seq;
+  uint16_t speedCentiKmh;
+  uint8_t batteryPct;
+  int16_t motorTempDeciC;
+};
+
+enum TelemetryStatus : uint8_t {
+  TELEMETRY_OK,
+  TELEMETRY_TOO_SHORT,   // fewer bytes than a 1.0 packet
+  TELEMETRY_BAD_MAGIC,
+  TELEMETRY_BAD_VERSION, // unknown major version
+  TELEMETRY_BAD_LENGTH,  // length field disagrees with the bytes received
+  TELEMETRY_BAD_CRC,
+};
+
+namespace telemetry_detail {
+
+inline uint16_t get16(const uint8_t *p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+inline void put16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+} // namespace telemetry_detail
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), bitwise: packets are a dozen bytes
+inline uint16_t telemetryCrc(const uint8_t *data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  while (len--) {
+    crc ^= (uint16_t)(*data++ << 8);
+    for (uint8_t i = 0; i < 8; i++) crc = crc & 0x8000 ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+// Parse len bytes at data into out, which is only written on TELEMETRY_OK
+inline TelemetryStatus decodeTelemetry(const uint8_t *data, size_t len, Telemetry &out) {
+  using namespace telemetry_detail;
+  if (!data || len < TELEMETRY_SIZE) return TELEMETRY_TOO_SHORT;
+  if (data[0] != TELEMETRY_MAGIC) return TELEMETRY_BAD_MAGIC;
+  if ((data[1] >> 4) != (TELEMETRY_VERSION >> 4)) return TELEMETRY_BAD_VERSION;
+  if (data[2] != len) return TELEMETRY_BAD_LENGTH;
+  if (telemetryCrc(data, len - 2) != get16(data + len - 2)) return TELEMETRY_BAD_CRC;
+  out.seq = get16(data + 3);
+  out.speedCentiKmh = get16(data + 5);
+  out.batteryPct = data[7];
+  out.motorTempDeciC = (int16_t)get16(data + 8);
+  return TELEMETRY_OK;
+}
+
+// Write a 1.0 packet into out, returns its length or 0 if cap is too small
+inline size_t encodeTelemetry(const Telemetry &t, uint8_t *out, size_t cap) {
+  using namespace telemetry_detail;
+  if (cap < TELEMETRY_SIZE) return 0;
+  out[0] = TELEMETRY_MAGIC;
+  out[1] = TELEMETRY_VERSION;
+  out[2] = TELEMETRY_SIZE;
+  put16(out + 3, t.seq);
+  put16(out + 5, t.speedCentiKmh);
+  out[7] = t.batteryPct;
+  put16(out + 8, (uint16_t)t.motorTempDeciC);
+  put16(out + 10, telemetryCrc(out, TELEMETRY_SIZE - 2));
+  return TELEMETRY_SIZE;
+}
+
+inline const char *telemetryStatusName(TelemetryStatus s) {
+  static const char *const names[] = { "ok", "too short", "bad magic", "bad version", "bad length", "bad crc" };
+  return s <= TELEMETRY_BAD_CRC ? names[s] : "?";
+}
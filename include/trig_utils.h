@@ -0,0 +1,78 @@
+#pragma once
+#include <stdint.h>
+
+// Fixed-point trig for the gauge geometry.
+// All angles are in degrees (or quarter degrees for the *Steps variants), sines
+// and cosines are Q15 with 32768 == 1.0. The table only covers 0..90 degrees and
+// is generated at compile time, so nothing here touches the FPU at runtime.
+
+namespace trig {
+
+const int STEPS_PER_DEG = 4;                  // 0.25 degree resolution
+const int QUARTER_STEPS = 90 * STEPS_PER_DEG; // steps in 0..90 degrees
+const int FULL_STEPS = 360 * STEPS_PER_DEG;   // steps in a full turn
+
+// Taylor series sine for 0..pi/2, only used to build the table
+constexpr double taylorSin(double x) {
+  double term = x;
+  double sum = x;
+  for (int n = 1; n < 12; n++) {
+    term *= -x * x / ((2 * n) * (2 * n + 1));
+    sum += term;
+  }
+  return sum;
+}
+
+struct SinTable {
+  uint16_t q15[QUARTER_STEPS + 1];
+  constexpr SinTable() : q15() {
+    for (int i = 0; i <= QUARTER_STEPS; i++) {
+      double rad = i * (3.14159265358979323846 / (180.0 * STEPS_PER_DEG));
+      q15[i] = (uint16_t)(taylorSin(rad) * 32768.0 + 0.5);
+    }
+  }
+};
+
+constexpr SinTable sinTable{};
+
+// sin of an angle given in quarter degrees, any range
+inline int32_t sinQ15Steps(int32_t steps) {
+  steps %= FULL_STEPS;
+  if (steps < 0) steps += FULL_STEPS;
+  if (steps <= QUARTER_STEPS) return sinTable.q15[steps];
+  if (steps <= 2 * QUARTER_STEPS) return sinTable.q15[2 * QUARTER_STEPS - steps];
+  if (steps <= 3 * QUARTER_STEPS) return -sinTable.q15[steps - 2 * QUARTER_STEPS];
+  return -sinTable.q15[FULL_STEPS - steps];
+}
+
+inline int32_t cosQ15Steps(int32_t steps) {
+  return sinQ15Steps(steps + QUARTER_STEPS);
+}
+
+inline int32_t sinQ15(int32_t deg) { return sinQ15Steps(deg * STEPS_PER_DEG); }
+inline int32_t cosQ15(int32_t deg) { return cosQ15Steps(deg * STEPS_PER_DEG); }
+
+// Polar to cartesian, integer radius. Rounds down like the (int) casts this replaces.
+inline int32_t polarX(int32_t cx, int32_t r, int32_t deg) { return cx + ((r * cosQ15(deg)) >> 15); }
+inline int32_t polarY(int32_t cy, int32_t r, int32_t deg) { return cy + ((r * sinQ15(deg)) >> 15); }
+
+// Integer square root, floor(sqrt(v)) for v >= 0
+constexpr int32_t isqrt(int32_t v) {
+  if (v <= 0) return 0;
+  uint32_t x = (uint32_t)v;
+  uint32_t res = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > x) bit >>= 2;
+  while (bit) {
+    if (x >= res + bit) {
+      x -= res + bit;
+      res = (res >> 1) + bit;
+    } else {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (int32_t)res;
+}
+
+} // namespace trig
@@ -0,0 +1,45 @@
+#include <Arduino.h>
+#include <soc/gpio_struct.h>
+#include <stdarg.h>
+#include <chrono>
+#include <thread>
+
+HostSerial Serial;
+gpio_dev_t GPIO;
+
+static const std::chrono::steady_clock::time_point bootTime = std::chrono::steady_clock::now();
+static uint8_t pinLevels[64];
+
+uint32_t millis() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+uint32_t micros() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  if (pin < 32) {
+    if (val) GPIO.out_w1ts = 1UL << pin;
+    else GPIO.out_w1tc = 1UL << pin;
+  } else if (pin < sizeof(pinLevels)) {
+    pinLevels[pin] = val;
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  if (pin < 32) return (GPIO.out >> pin) & 1;
+  return pin < sizeof(pinLevels) ? pinLevels[pin] : LOW;
+}
+
+int HostSerial::printf(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int n = vprintf(fmt, args);
+  va_end(args);
+  return n;
+}
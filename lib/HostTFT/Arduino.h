@@ -0,0 +1,48 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+// The parts of the Arduino core the screen code uses, for the native build.
+// Time comes from steady_clock, pins are only remembered, Serial goes to stdout.
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+
+typedef uint8_t byte;
+
+using std::max;
+using std::min;
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+class HostSerial {
+public:
+  void begin(unsigned long) {}
+  void print(const char *s) { fputs(s, stdout); }
+  void print(long v) { printf("%ld", v); }
+  void println(const char *s = "") { puts(s); }
+  void println(long v) { printf("%ld\n", v); }
+  int printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HostSerial Serial;
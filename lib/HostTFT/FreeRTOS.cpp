@@ -0,0 +1,127 @@
+#include <freertos/FreeRTOS.h>
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct HostSemaphore {
+  std::mutex m;
+  std::condition_variable cv;
+  bool given = false;
+};
+
+struct HostQueue {
+  std::mutex m;
+  std::condition_variable cv;
+  std::deque<std::vector<uint8_t>> items;
+  UBaseType_t length;
+  UBaseType_t itemSize;
+};
+
+struct HostTask {
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t notified = 0;
+};
+
+static thread_local HostTask *currentTask = nullptr;
+
+// Wait on cv until ready() or the timeout; portMAX_DELAY waits forever
+template <typename Lock, typename Ready>
+static bool waitFor(std::condition_variable &cv, Lock &lock, TickType_t wait, Ready ready) {
+  if (wait == portMAX_DELAY) {
+    cv.wait(lock, ready);
+    return true;
+  }
+  return cv.wait_for(lock, std::chrono::milliseconds(wait), ready);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *, uint32_t, void *arg, UBaseType_t, TaskHandle_t *handle,
+                                   BaseType_t) {
+  HostTask *task = new HostTask(); // lives as long as the task, which never returns
+  if (handle) *handle = task;
+  std::thread([fn, arg, task] {
+    currentTask = task;
+    fn(arg);
+  }).detach();
+  return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+  {
+    std::lock_guard<std::mutex> lock(task->m);
+    task->notified++;
+  }
+  task->cv.notify_one();
+  return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t wait) {
+  HostTask *task = currentTask;
+  if (!task) return 0; // not called from a task
+  std::unique_lock<std::mutex> lock(task->m);
+  if (!waitFor(task->cv, lock, wait, [task] { return task->notified > 0; })) return 0;
+  const uint32_t count = task->notified;
+  task->notified = clearOnExit ? 0 : count - 1;
+  return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return new HostSemaphore(); }
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  {
+    std::lock_guard<std::mutex> lock(sem->m);
+    if (sem->given) return pdFAIL;
+    sem->given = true;
+  }
+  sem->cv.notify_one();
+  return pdPASS;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait) {
+  std::unique_lock<std::mutex> lock(sem->m);
+  if (!waitFor(sem->cv, lock, wait, [sem] { return sem->given; })) return pdFAIL;
+  sem->given = false;
+  return pdPASS;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) { delete sem; }
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+  HostQueue *q = new HostQueue();
+  q->length = length;
+  q->itemSize = itemSize;
+  return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait) {
+  {
+    std::unique_lock<std::mutex> lock(q->m);
+    if (!waitFor(q->cv, lock, wait, [q] { return q->items.size() < q->length; })) return pdFAIL;
+    const uint8_t *bytes = (const uint8_t *)item;
+    q->items.emplace_back(bytes, bytes + q->itemSize);
+  }
+  q->cv.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait) {
+  {
+    std::unique_lock<std::mutex> lock(q->m);
+    if (!waitFor(q->cv, lock, wait, [q] { return !q->items.empty(); })) return pdFAIL;
+    memcpy(item, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+  }
+  q->cv.notify_all();
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+  std::lock_guard<std::mutex> lock(q->m);
+  return (UBaseType_t)q->items.size();
+}
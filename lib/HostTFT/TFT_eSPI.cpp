@@ -0,0 +1,323 @@
+#include <TFT_eSPI.h>
+#include "glcdfont.h"
+
+TFT_eSPI::TFT_eSPI(int16_t w, int16_t h) : _width(w), _height(h) {}
+
+void TFT_eSPI::begin() {
+  for (uint8_t i = 0; i < MAX_PANELS; i++) _fb[i].assign((size_t)_width * _height, 0);
+}
+
+void TFT_eSPI::drawPixel(int32_t x, int32_t y, uint32_t color) { fillRect(x, y, 1, 1, color); }
+
+void TFT_eSPI::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+  if (x < 0) { w += x; x = 0; }
+  if (y < 0) { h += y; y = 0; }
+  if (x + w > _width) w = _width - x;
+  if (y + h > _height) h = _height - y;
+  if (w <= 0 || h <= 0) return;
+  std::vector<uint16_t> &fb = _fb[_panel];
+  if (fb.empty()) begin();
+  for (int32_t row = y; row < y + h; row++) {
+    std::fill(fb.begin() + row * _width + x, fb.begin() + row * _width + x + w, (uint16_t)color);
+  }
+  _pixelsWritten += (uint64_t)w * h;
+}
+
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data) {
+  std::vector<uint16_t> &fb = _fb[_panel];
+  if (fb.empty()) begin();
+  for (int32_t row = 0; row < h; row++) {
+    if (y + row < 0 || y + row >= _height) continue;
+    for (int32_t col = 0; col < w; col++) {
+      if (x + col < 0 || x + col >= _width) continue;
+      fb[(y + row) * _width + x + col] = data[row * w + col];
+    }
+  }
+  _pixelsWritten += (uint64_t)w * h;
+}
+
+void TFT_eSPI::drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color) {
+  const bool steep = abs(y1 - y0) > abs(x1 - x0);
+  if (steep) {
+    std::swap(x0, y0);
+    std::swap(x1, y1);
+  }
+  if (x0 > x1) {
+    std::swap(x0, x1);
+    std::swap(y0, y1);
+  }
+  const int32_t dx = x1 - x0, dy = abs(y1 - y0);
+  const int32_t ystep = y0 < y1 ? 1 : -1;
+  int32_t err = dx >> 1;
+  for (; x0 <= x1; x0++) {
+    if (steep) drawPixel(y0, x0, color);
+    else drawPixel(x0, y0, color);
+    err -= dy;
+    if (err < 0) {
+      err += dx;
+      y0 += ystep;
+    }
+  }
+}
+
+void TFT_eSPI::drawCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color) {
+  int32_t f = 1 - r, ddx = 1, ddy = -2 * r, x = 0, y = r;
+  drawPixel(x0, y0 + r, color);
+  drawPixel(x0, y0 - r, color);
+  drawPixel(x0 + r, y0, color);
+  drawPixel(x0 - r, y0, color);
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddy += 2;
+      f += ddy;
+    }
+    x++;
+    ddx += 2;
+    f += ddx;
+    drawPixel(x0 + x, y0 + y, color);
+    drawPixel(x0 - x, y0 + y, color);
+    drawPixel(x0 + x, y0 - y, color);
+    drawPixel(x0 - x, y0 - y, color);
+    drawPixel(x0 + y, y0 + x, color);
+    drawPixel(x0 - y, y0 + x, color);
+    drawPixel(x0 + y, y0 - x, color);
+    drawPixel(x0 - y, y0 - x, color);
+  }
+}
+
+void TFT_eSPI::fillCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color) {
+  int32_t f = 1 - r, ddx = 1, ddy = -2 * r, x = 0, y = r;
+  drawFastHLine(x0 - r, y0, 2 * r + 1, color);
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddy += 2;
+      f += ddy;
+    }
+    x++;
+    ddx += 2;
+    f += ddx;
+    drawFastHLine(x0 - x, y0 + y, 2 * x + 1, color);
+    drawFastHLine(x0 - x, y0 - y, 2 * x + 1, color);
+    drawFastHLine(x0 - y, y0 + x, 2 * y + 1, color);
+    drawFastHLine(x0 - y, y0 - x, 2 * y + 1, color);
+  }
+}
+
+void TFT_eSPI::fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color) {
+  // sort by y, then fill the flat-bottom and flat-top halves with spans
+  if (y0 > y1) { std::swap(y0, y1); std::swap(x0, x1); }
+  if (y1 > y2) { std::swap(y2, y1); std::swap(x2, x1); }
+  if (y0 > y1) { std::swap(y0, y1); std::swap(x0, x1); }
+
+  if (y0 == y2) {
+    int32_t a = std::min(x0, std::min(x1, x2));
+    int32_t b = std::max(x0, std::max(x1, x2));
+    drawFastHLine(a, y0, b - a + 1, color);
+    return;
+  }
+  const int32_t dx01 = x1 - x0, dy01 = y1 - y0, dx02 = x2 - x0, dy02 = y2 - y0;
+  const int32_t dx12 = x2 - x1, dy12 = y2 - y1;
+  int32_t sa = 0, sb = 0;
+  const int32_t last = y1 == y2 ? y1 : y1 - 1;
+  int32_t y = y0;
+  for (; y <= last; y++) {
+    int32_t a = x0 + sa / dy01;
+    int32_t b = x0 + sb / dy02;
+    sa += dx01;
+    sb += dx02;
+    if (a > b) std::swap(a, b);
+    drawFastHLine(a, y, b - a + 1, color);
+  }
+  sa = dx12 * (y - y1);
+  sb = dx02 * (y - y0);
+  for (; y <= y2; y++) {
+    int32_t a = x1 + sa / dy12;
+    int32_t b = x0 + sb / dy02;
+    sa += dx12;
+    sb += dx02;
+    if (a > b) std::swap(a, b);
+    drawFastHLine(a, y, b - a + 1, color);
+  }
+}
+
+void TFT_eSPI::drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint16_t color) {
+  const int32_t stride = (w + 7) / 8;
+  for (int32_t j = 0; j < h; j++) {
+    for (int32_t i = 0; i < w; i++) {
+      if (pgm_read_byte(bitmap + j * stride + i / 8) & (0x80 >> (i & 7))) drawPixel(x + i, y + j, color);
+    }
+  }
+}
+
+void TFT_eSPI::drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size) {
+  if (size == 0) size = 1;
+  const bool fillBg = bg != color;
+  for (int8_t col = 0; col < 6; col++) {
+    uint8_t line = 0;
+    if (col < 5 && c >= GLCD_FIRST && c <= GLCD_LAST) line = glcdFont[(c - GLCD_FIRST) * 5 + col];
+    for (int8_t row = 0; row < 8; row++, line >>= 1) {
+      if (line & 1) fillRect(x + col * size, y + row * size, size, size, color);
+      else if (fillBg) fillRect(x + col * size, y + row * size, size, size, bg);
+    }
+  }
+}
+
+void TFT_eSPI::print(const char *s) {
+  for (; *s; s++) {
+    if (*s == '\n') {
+      _cursorX = 0;
+      _cursorY += 8 * _textSize;
+      continue;
+    }
+    drawChar(_cursorX, _cursorY, *s, _textColor, _textBg, _textSize);
+    _cursorX += 6 * _textSize;
+  }
+}
+
+void TFT_eSPI::println(const char *s) {
+  print(s);
+  print("\n");
+}
+
+uint16_t TFT_eSPI::color8to16(uint8_t color) {
+  static const uint8_t blue[] = { 0, 11, 21, 31 }; // blue 2 to 5-bit colour lookup table
+  uint16_t color16 = (color & 0x1C) << 6 | (color & 0xC0) << 5 | (color & 0xE0) << 8;
+  color16 |= (color & 0x1C) << 3 | blue[color & 0x03];
+  return color16;
+}
+
+uint8_t TFT_eSPI::color16to8(uint16_t c) {
+  return ((c & 0xE000) >> 8) | ((c & 0x0700) >> 6) | ((c & 0x0018) >> 3);
+}
+
+void TFT_eSPI::setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h) {
+  _winX = x;
+  _winY = y;
+  _winW = w;
+  _winH = h;
+  _winPos = 0;
+  busEvent(BUS_ADDR_WINDOW, w > 0 && h > 0 ? (uint32_t)(w * h) : 0);
+}
+
+void TFT_eSPI::pushPixelsDMA(uint16_t *image, uint32_t len) {
+  busEvent(BUS_PIXELS_DMA, len);
+  std::vector<uint16_t> &fb = _fb[_panel];
+  if (fb.empty()) begin();
+  for (uint32_t i = 0; i < len && _winW > 0; i++, _winPos++) {
+    const int32_t x = _winX + (int32_t)(_winPos % _winW), y = _winY + (int32_t)(_winPos / _winW);
+    if (x < 0 || y < 0 || x >= _width || y >= _height) continue;
+    fb[(size_t)y * _width + x] = (uint16_t)(image[i] << 8 | image[i] >> 8);
+  }
+  _pixelsWritten += len;
+}
+
+std::vector<uint8_t> TFT_eSPI::encodePPM(uint8_t panel) const {
+  std::vector<uint8_t> out;
+  if (panel >= MAX_PANELS || _fb[panel].empty()) return out;
+  char header[32];
+  const int n = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", _width, _height);
+  out.assign(header, header + n);
+  out.reserve(n + _fb[panel].size() * 3);
+  for (uint16_t c : _fb[panel]) {
+    out.push_back((uint8_t)(((c >> 11) & 0x1F) * 255 / 31));
+    out.push_back((uint8_t)(((c >> 5) & 0x3F) * 255 / 63));
+    out.push_back((uint8_t)((c & 0x1F) * 255 / 31));
+  }
+  return out;
+}
+
+bool TFT_eSPI::writePPM(uint8_t panel, const char *path) const {
+  const std::vector<uint8_t> ppm = encodePPM(panel);
+  if (ppm.empty()) return false;
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+  fwrite(ppm.data(), 1, ppm.size(), f);
+  return fclose(f) == 0;
+}
+
+// TFT_eSPI's default 4-bit palette
+static const uint16_t default4bitPalette[16] = {
+  TFT_BLACK, TFT_BROWN, TFT_RED, TFT_ORANGE, TFT_YELLOW, TFT_GREEN, TFT_BLUE, TFT_PURPLE,
+  TFT_DARKGREY, TFT_WHITE, TFT_CYAN, TFT_MAGENTA, TFT_MAROON, TFT_DARKGREEN, TFT_NAVY, TFT_PINK,
+};
+
+void *TFT_eSprite::setColorDepth(int8_t b) {
+  _bpp = b == 8 ? 8 : b == 4 ? 4 : 16;
+  if (created()) return createSprite(_width, _height);
+  return nullptr;
+}
+
+void *TFT_eSprite::createSprite(int16_t w, int16_t h, uint8_t) {
+  _width = w;
+  _height = h;
+  _buf.assign(_bpp == 4 ? (size_t)(w + 1) / 2 * h : (size_t)w * h * (_bpp / 8), 0);
+  if (_bpp == 4) createPalette(default4bitPalette);
+  return getPointer();
+}
+
+void TFT_eSprite::createPalette(const uint16_t *palette, uint8_t colors) {
+  if (colors > 16) colors = 16;
+  for (uint8_t i = 0; i < 16; i++) {
+    _palette[i] = palette && i < colors ? palette[i] : default4bitPalette[i];
+  }
+}
+
+void TFT_eSprite::deleteSprite() {
+  _buf.clear();
+  _buf.shrink_to_fit();
+}
+
+void TFT_eSprite::drawPixel(int32_t x, int32_t y, uint32_t color) {
+  if (x < 0 || y < 0 || x >= _width || y >= _height || !created()) return;
+  if (_bpp == 8) _buf[y * _width + x] = color16to8(color);
+  else if (_bpp == 4) {
+    uint8_t &b = _buf[y * ((_width + 1) / 2) + x / 2];
+    b = x & 1 ? (b & 0xF0) | (color & 0x0F) : (uint8_t)(((color & 0x0F) << 4) | (b & 0x0F));
+  } else ((uint16_t *)_buf.data())[y * _width + x] = (uint16_t)color;
+}
+
+void TFT_eSprite::fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+  if (!created()) return;
+  if (x < 0) { w += x; x = 0; }
+  if (y < 0) { h += y; y = 0; }
+  if (x + w > _width) w = _width - x;
+  if (y + h > _height) h = _height - y;
+  if (w <= 0 || h <= 0) return;
+  for (int32_t row = y; row < y + h; row++) {
+    if (_bpp == 8) {
+      memset(&_buf[row * _width + x], color16to8(color), w);
+    } else if (_bpp == 4) {
+      for (int32_t col = x; col < x + w; col++) drawPixel(col, row, color);
+    } else {
+      uint16_t *p = (uint16_t *)_buf.data() + row * _width + x;
+      std::fill(p, p + w, (uint16_t)color);
+    }
+  }
+}
+
+void TFT_eSprite::pushSprite(int32_t x, int32_t y) { pushSprite(x, y, 0, 0, _width, _height); }
+
+bool TFT_eSprite::pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh) {
+  if (!created() || sx < 0 || sy < 0 || sw <= 0 || sh <= 0 || sx + sw > _width || sy + sh > _height) return false;
+  _tft->busEvent(BUS_START_WRITE, 0);
+  _tft->busEvent(BUS_ADDR_WINDOW, (uint32_t)(sw * sh));
+  _tft->busEvent(BUS_PIXELS, (uint32_t)(sw * sh));
+  std::vector<uint16_t> line(sw);
+  for (int32_t row = 0; row < sh; row++) {
+    for (int32_t col = 0; col < sw; col++) {
+      if (_bpp == 4) {
+        const int32_t x = sx + col;
+        const uint8_t b = _buf[(size_t)(sy + row) * ((_width + 1) / 2) + x / 2];
+        line[col] = _palette[x & 1 ? b & 0x0F : b >> 4];
+        continue;
+      }
+      const size_t i = (size_t)(sy + row) * _width + sx + col;
+      line[col] = _bpp == 8 ? color8to16(_buf[i]) : ((const uint16_t *)_buf.data())[i];
+    }
+    _tft->pushImage(tx, ty + row, sw, 1, line.data());
+  }
+  _tft->busEvent(BUS_END_WRITE, 0);
+  return true;
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <Arduino.h>
+
+// Software stand-in for the subset of TFT_eSPI / TFT_eSprite the screens use.
+// Drawing on TFT_eSPI goes to the framebuffer of the selected panel (RGB565,
+// one per panel sharing the bus, like the chip selects on the board); sprites
+// keep their pixels in memory at 4 (palettised), 8 or 16 bpp with the library's
+// colour conversions, so getPointer() users see the same layout as on the device.
+// Primitives follow the library's algorithms closely but are not guaranteed to
+// match it pixel for pixel.
+
+#ifndef TFT_WIDTH
+#define TFT_WIDTH  240
+#endif
+#ifndef TFT_HEIGHT
+#define TFT_HEIGHT 240
+#endif
+
+#define TFT_BLACK       0x0000      /*   0,   0,   0 */
+#define TFT_NAVY        0x000F      /*   0,   0, 128 */
+#define TFT_DARKGREEN   0x03E0      /*   0, 128,   0 */
+#define TFT_DARKCYAN    0x03EF      /*   0, 128, 128 */
+#define TFT_MAROON      0x7800      /* 128,   0,   0 */
+#define TFT_PURPLE      0x780F      /* 128,   0, 128 */
+#define TFT_OLIVE       0x7BE0      /* 128, 128,   0 */
+#define TFT_LIGHTGREY   0xC618      /* 192, 192, 192 */
+#define TFT_DARKGREY    0x7BEF      /* 128, 128, 128 */
+#define TFT_BLUE        0x001F      /*   0,   0, 255 */
+#define TFT_GREEN       0x07E0      /*   0, 255,   0 */
+#define TFT_CYAN        0x07FF      /*   0, 255, 255 */
+#define TFT_RED         0xF800      /* 255,   0,   0 */
+#define TFT_MAGENTA     0xF81F      /* 255,   0, 255 */
+#define TFT_YELLOW      0xFFE0      /* 255, 255,   0 */
+#define TFT_WHITE       0xFFFF      /* 255, 255, 255 */
+#define TFT_ORANGE      0xFDA0      /* 255, 180,   0 */
+#define TFT_BROWN       0x9A60      /* 150,  75,   0 */
+#define TFT_PINK        0xFE19      /* 255, 192, 203 */
+#define TFT_TRANSPARENT 0x0120      /* This is actually a dark green */
+
+// setAttribute() ids
+#define PSRAM_ENABLE 3
+
+// Host only: what went over the bus, in order (see TFT_eSPI::setBusMonitor)
+enum BusOp : uint8_t {
+  BUS_START_WRITE, // transaction begins (CS would go low)
+  BUS_ADDR_WINDOW, // count: window pixels
+  BUS_PIXELS,      // count: pixels pushed synchronously (pushSprite)
+  BUS_PIXELS_DMA,  // count: pixels queued for DMA
+  BUS_DMA_WAIT,
+  BUS_END_WRITE,
+};
+
+class BusMonitor {
+public:
+  virtual ~BusMonitor() {}
+  // Called on the thread that drives the bus, panel as selected at the time
+  virtual void onBus(BusOp op, uint8_t panel, uint32_t count) = 0;
+};
+
+class TFT_eSPI {
+public:
+  static const uint8_t MAX_PANELS = 2;
+
+  TFT_eSPI(int16_t w = TFT_WIDTH, int16_t h = TFT_HEIGHT);
+  virtual ~TFT_eSPI() {}
+
+  void init() { begin(); }
+  void begin();
+  void setRotation(uint8_t r) { _rotation = r & 3; }
+  uint8_t getRotation() const { return _rotation; }
+  int16_t width() const { return _width; }
+  int16_t height() const { return _height; }
+
+  void fillScreen(uint32_t color) { fillRect(0, 0, _width, _height, color); }
+  virtual void drawPixel(int32_t x, int32_t y, uint32_t color);
+  virtual void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+  void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) { fillRect(x, y, w, 1, color); }
+  void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) { fillRect(x, y, 1, h, color); }
+  void drawLine(int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t color);
+  void drawCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color);
+  void fillCircle(int32_t x0, int32_t y0, int32_t r, uint32_t color);
+  void fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t color);
+  void drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w, int16_t h, uint16_t color);
+  // GLCD font (font 1), 6x8 cell per character at size 1
+  void drawChar(int32_t x, int32_t y, uint16_t c, uint32_t color, uint32_t bg, uint8_t size);
+
+  void setTextColor(uint16_t c) { _textColor = _textBg = c; }
+  void setTextColor(uint16_t c, uint16_t bg) { _textColor = c; _textBg = bg; }
+  void setTextSize(uint8_t s) { _textSize = s ? s : 1; }
+  void setCursor(int16_t x, int16_t y) { _cursorX = x; _cursorY = y; }
+  void print(const char *s);
+  void println(const char *s = "");
+
+  uint16_t color8to16(uint8_t color);
+  uint8_t color16to8(uint16_t color);
+  // No PSRAM on the host, accepted and ignored
+  void setAttribute(uint8_t id, uint8_t a) { (void)id; (void)a; }
+
+  // Host only: the panel that receives drawing, its pixels, and a PPM dump of them
+  void selectPanel(uint8_t panel) { _panel = panel < MAX_PANELS ? panel : 0; }
+  const uint16_t *panelPixels(uint8_t panel) const { return _fb[panel].data(); }
+  bool writePPM(uint8_t panel, const char *path) const;
+  std::vector<uint8_t> encodePPM(uint8_t panel) const; // the bytes writePPM writes, empty if no panel
+  // Pixels written to any panel so far, what would have gone over SPI at 2 bytes each
+  uint64_t pixelsWritten() const { return _pixelsWritten; }
+  // Copy RGB565 pixels into the selected panel, clipped
+  void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data);
+
+  // SPI transactions and DMA as the frame pipeline uses them. The host bus takes
+  // the pixels at once, into the address window of the selected panel.
+  bool initDMA() { return true; }
+  void startWrite() { busEvent(BUS_START_WRITE, 0); }
+  void endWrite() { busEvent(BUS_END_WRITE, 0); }
+  void setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h);
+  // Byte-swapped RGB565, as the DMA sends it; the real call waits for the previous transfer first
+  void pushPixelsDMA(uint16_t *image, uint32_t len);
+  void dmaWait() { busEvent(BUS_DMA_WAIT, 0); }
+  // Host only: report every bus call, e.g. to check their order or to slow transfers down
+  void setBusMonitor(BusMonitor *monitor) { _monitor = monitor; }
+  void busEvent(BusOp op, uint32_t count) {
+    if (_monitor) _monitor->onBus(op, _panel, count);
+  }
+
+protected:
+  int16_t _width, _height;
+
+private:
+  uint8_t _rotation = 0;
+  uint8_t _panel = 0;
+  std::vector<uint16_t> _fb[MAX_PANELS];
+  uint64_t _pixelsWritten = 0;
+  BusMonitor *_monitor = nullptr;
+  int32_t _winX = 0, _winY = 0, _winW = 0, _winH = 0;
+  uint32_t _winPos = 0; // next pixel of the address window
+  uint16_t _textColor = TFT_WHITE, _textBg = TFT_WHITE;
+  uint8_t _textSize = 1;
+  int16_t _cursorX = 0, _cursorY = 0;
+};
+
+class TFT_eSprite : public TFT_eSPI {
+public:
+  explicit TFT_eSprite(TFT_eSPI *tft) : TFT_eSPI(0, 0), _tft(tft) {}
+
+  void *setColorDepth(int8_t b);
+  int8_t getColorDepth() const { return _bpp; }
+  void *createSprite(int16_t w, int16_t h, uint8_t frames = 1);
+  void deleteSprite();
+  bool created() const { return !_buf.empty(); }
+  void *getPointer() { return created() ? _buf.data() : nullptr; }
+  void fillSprite(uint32_t color) { fillRect(0, 0, _width, _height, color); }
+  // 4-bit sprites: colours passed to drawing calls are indices into this palette
+  void createPalette(const uint16_t *palette = nullptr, uint8_t colors = 16);
+  uint16_t getPaletteColor(uint8_t index) const { return _palette[index & 0x0F]; }
+
+  void drawPixel(int32_t x, int32_t y, uint32_t color) override;
+  void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) override;
+
+  // Whole sprite at (x, y), or the sw x sh window at (sx, sy) of it to (tx, ty)
+  void pushSprite(int32_t x, int32_t y);
+  bool pushSprite(int32_t tx, int32_t ty, int32_t sx, int32_t sy, int32_t sw, int32_t sh);
+
+private:
+  TFT_eSPI *_tft;
+  int8_t _bpp = 16;
+  std::vector<uint8_t> _buf;
+  uint16_t _palette[16] = {};
+};
@@ -0,0 +1,14 @@
+#pragma once
+#include <stdlib.h>
+
+// Capability-aware allocation; the host has one kind of memory
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_8BIT (1 << 2)
+
+inline void *heap_caps_malloc(size_t size, uint32_t caps) {
+  (void)caps;
+  return malloc(size);
+}
+inline void heap_caps_free(void *p) { free(p); }
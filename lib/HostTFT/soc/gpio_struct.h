@@ -0,0 +1,23 @@
+#pragma once
+#include <stdint.h>
+
+// GPIO 0..31 output registers for the native build. Like the hardware, a
+// write to out_w1ts sets and a write to out_w1tc clears the masked bits of
+// out; digitalWrite()/digitalRead() of those pins go through out as well.
+
+struct GpioWriteOne {
+  volatile uint32_t &out;
+  const bool set;
+  void operator=(uint32_t mask) const {
+    if (set) out = out | mask;
+    else out = out & ~mask;
+  }
+};
+
+struct gpio_dev_t {
+  volatile uint32_t out = 0;
+  const GpioWriteOne out_w1ts{ out, true };
+  const GpioWriteOne out_w1tc{ out, false };
+};
+
+extern gpio_dev_t GPIO;
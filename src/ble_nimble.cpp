@@ -0,0 +1,142 @@
+#include <ble_nimble.h>
+
+bool NimBleStack::begin() {
+  _client = NimBLEDevice::createClient();
+  if (!_client) return false;
+  _client->setClientCallbacks(this, false);
+  NimBLEScan *scan = NimBLEDevice::getScan();
+  scan->setScanCallbacks(this, false);
+  scan->setInterval(_scanConfig.intervalMs);
+  scan->setWindow(_scanConfig.windowMs);
+  scan->setActiveScan(_scanConfig.active);
+  // one report per device from the controller, and callbacks only, no result list
+  scan->setDuplicateFilter(true);
+  scan->setMaxResults(0);
+  // Next to the NimBLE host on core 0, away from the render loop
+  return xTaskCreatePinnedToCore(workerEntry, "bleSetup", 4096, this, 1, &_worker, 0) == pdPASS;
+}
+
+bool NimBleStack::startScan(uint32_t durationMs) {
+  _matched = false;
+  return NimBLEDevice::getScan()->start(durationMs, false, true);
+}
+
+void NimBleStack::stopScan() {
+  NimBLEDevice::getScan()->stop();
+}
+
+bool NimBleStack::connect(const BleAddress &peer, uint32_t timeoutMs) {
+  ble_addr_t addr;
+  addr.type = peer.type;
+  memcpy(addr.val, peer.val, sizeof(addr.val));
+  _client->setConnectTimeout(timeoutMs);
+  // asynchronous: onConnect or onConnectFail follows. No need to delete
+  // attributes here, release() has freed the last connection's or will once
+  // the worker is done with them
+  return _client->connect(NimBLEAddress(addr), false, true);
+}
+
+bool NimBleStack::setup() {
+  // still discovering on an earlier link that timed out
+  if (!_gate.beginSetup()) return false;
+  // nothing from an earlier link may survive into this one's discovery
+  _session.invalidate();
+  _setup = BLE_SETUP_BUSY;
+  xTaskNotifyGive(_worker);
+  return true;
+}
+
+void NimBleStack::disconnect() {
+  if (_client->isConnected()) _client->disconnect();
+  else _client->cancelConnect();
+}
+
+void NimBleStack::release() {
+  // with the worker still discovering on the dropped link, it frees them when done
+  if (_gate.release()) freeAttributes();
+}
+
+void NimBleStack::freeAttributes() {
+  // discovery may have bound the session after onDisconnect() cleared it
+  _session.invalidate();
+  _client->deleteServices();
+}
+
+bool NimBleStack::read(NimBLEAttValue &value) {
+  NimBLERemoteCharacteristic *characteristic = _session.get();
+  if (characteristic == nullptr) return false;
+  value = characteristic->readValue();
+  return true;
+}
+
+// The advertisement itself: matches without waiting for the scan response
+void NimBleStack::onDiscovered(const NimBLEAdvertisedDevice *device) {
+  match(device);
+}
+
+// Advertisement plus scan response, for a UUID only in the latter
+void NimBleStack::onResult(const NimBLEAdvertisedDevice *device) {
+  match(device);
+}
+
+void NimBleStack::match(const NimBLEAdvertisedDevice *device) {
+  if (_matched || !device->isConnectable()) return;
+  const std::vector<uint8_t> &payload = device->getPayload();
+  if (!advertisesService(payload.data(), payload.size(), _serviceBytes)) return;
+  _matched = true;
+  // Post a copy of the address and leave the scan running: stopping it here
+  // would clear the results and free `device` under this callback. BleLink
+  // stops the scan from loop() when it takes the event.
+  BleEvent e = {};
+  e.type = BLE_FOUND;
+  const NimBLEAddress &addr = device->getAddress();
+  memcpy(e.addr.val, addr.getVal(), sizeof(e.addr.val));
+  e.addr.type = addr.getType();
+  _link.post(e);
+}
+
+void NimBleStack::onScanEnd(const NimBLEScanResults &results, int reason) {
+  _link.post(BLE_SCAN_END);
+}
+
+void NimBleStack::onConnect(NimBLEClient *client) {
+  _link.post(BLE_CONNECTED);
+}
+
+void NimBleStack::onConnectFail(NimBLEClient *client, int reason) {
+  _link.post(BLE_CONNECT_FAILED);
+}
+
+void NimBleStack::onDisconnect(NimBLEClient *client, int reason) {
+  // the remote attributes go with the connection
+  _session.invalidate();
+  _link.post(BLE_DISCONNECTED);
+}
+
+void NimBleStack::workerEntry(void *arg) {
+  NimBleStack *self = (NimBleStack *)arg;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    self->_setup = self->subscribe() ? BLE_SETUP_OK : BLE_SETUP_FAILED;
+    if (self->_gate.endSetup()) self->freeAttributes();
+  }
+}
+
+// Discover the telemetry characteristic on the new link and enable
+// notifications (or indications) on it; blocks for the GATT round trips
+bool NimBleStack::subscribe() {
+  NimBLERemoteCharacteristic *characteristic = discover();
+  if (characteristic == nullptr) return false;
+  if (!characteristic->canNotify() && !characteristic->canIndicate()) return false;
+  return characteristic->subscribe(characteristic->canNotify(), _onNotify);
+}
+
+NimBLERemoteCharacteristic *NimBleStack::discover() {
+  _session.lookup();
+  NimBLERemoteService *service = _client->getService(_service);
+  if (service == nullptr) return nullptr;
+  _session.lookup();
+  NimBLERemoteCharacteristic *characteristic = service->getCharacteristic(_characteristic);
+  if (characteristic != nullptr && _client->isConnected()) _session.bind(characteristic);
+  return characteristic;
+}
@@ -0,0 +1,113 @@
+// Native entry point (env:native): runs the screen renderers against the
+// software TFT backend in lib/HostTFT, with the same demo sensor motion as
+// loop(), reports render time per screen (and per widget with
+// -D FRAME_PROFILER), and writes the last frame of each panel as a PPM. The
+// checks and benchmarks live in test/ (pio test -e native).
+//
+// usage: program [frames] [output dir] [shock noise: dither | xorshift[:seed] | rand]
+//
+// The PPMs are reproducible with the default dither, or xorshift with a seed.
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <TFT_eSPI.h>
+#include <dirty_rects.h>
+#include <frame_profiler.h>
+#include <screens.h>
+
+TFT_eSPI tft = TFT_eSPI();
+
+// pio test -e native links this file into every test for the tft above, with its own main()
+#ifndef PIO_UNIT_TESTING
+
+struct FrameStats {
+  double totalUs = 0;
+  double maxUs = 0;
+  uint64_t bytes = 0;
+  uint32_t frames = 0;
+
+  void add(double us, uint32_t frameBytes) {
+    totalUs += us;
+    if (us > maxUs) maxUs = us;
+    bytes += frameBytes;
+    frames++;
+  }
+  void print(const char *name) const {
+    printf("%s: %u frames, render avg %.1f us max %.1f us, %llu B/frame pushed\n", name, frames,
+           frames ? totalUs / frames : 0.0, maxUs, (unsigned long long)(frames ? bytes / frames : 0));
+  }
+};
+
+typedef void (*RenderFn)(TFT_eSprite &spr, DirtyTracker &dirty);
+
+// Render one frame of a panel, push its dirty windows and return the render time
+static double renderFrame(uint8_t panel, RenderFn render, TFT_eSprite &spr, DirtyTracker &dirty) {
+  const auto start = std::chrono::steady_clock::now();
+  render(spr, dirty);
+  const auto end = std::chrono::steady_clock::now();
+  tft.selectPanel(panel);
+  PROFILE_ZONE(PROF_PUSH);
+  dirty.push(spr);
+  return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+// "dither", "xorshift", "xorshift:<seed>" or "rand"
+static bool parseShockNoise(const std::string &arg) {
+  if (arg == "dither") shockNoiseMode = shocknoise::DITHER;
+  else if (arg == "rand") shockNoiseMode = shocknoise::LIBC_RAND;
+  else if (arg.compare(0, 8, "xorshift") == 0) {
+    shockNoiseMode = shocknoise::XORSHIFT;
+    shockNoiseSeed = arg.size() > 9 && arg[8] == ':' ? strtoul(arg.c_str() + 9, nullptr, 0) : 0;
+  } else return false;
+  return true;
+}
+
+int main(int argc, char **argv) {
+  const int frames = argc > 1 ? atoi(argv[1]) : 120;
+  const std::string outDir = argc > 2 ? argv[2] : ".";
+  if (argc > 3 && !parseShockNoise(argv[3])) {
+    fprintf(stderr, "unknown shock noise '%s'\n", argv[3]);
+    return 1;
+  }
+
+  tft.init();
+  TFT_eSprite img(&tft), img2(&tft);
+  // as DisplayScheduler::addPanel sets them up in setup()
+  img.setColorDepth(8);
+  img2.setColorDepth(4);
+  img.createSprite(tft.width(), tft.height());
+  img2.createSprite(tft.width(), tft.height());
+  img2.createPalette(palette::screen1Palette, 16);
+  DirtyTracker dirty0(tft.width(), tft.height(), true), dirty1(tft.width(), tft.height(), true);
+  if (!prepareScreen0Layers()) {
+    fprintf(stderr, "screen 0 layer cache failed\n");
+    return 1;
+  }
+
+  FrameStats stats0, stats1;
+  for (int f = 0; f < frames; f++) {
+    stats0.add(renderFrame(0, updateScreen0, img, dirty0), dirty0.lastFrameBytes());
+    stats1.add(renderFrame(1, updateScreen1, img2, dirty1), dirty1.lastFrameBytes());
+
+    // Demo sensor values, as in loop()
+    compassValue = (compassValue + 1) % 360;
+    shockSensorBackValue = shockSensorBackValue + 8 > 256 ? 0 : shockSensorBackValue + 8;
+    shockSensorFrontValue = shockSensorFrontValue + 8 > 256 ? 0 : shockSensorFrontValue + 8;
+    mapView.centerX = mapView.centerX + 1 < MAP_WIDTH ? mapView.centerX + 1 : 0;
+    mapView.heading = mapHeadingUp ? compassValue : 0;
+  }
+
+  stats0.print("screen0");
+  stats1.print("screen1");
+  PROFILE_REPORT(Serial);
+  bool ok = true;
+  for (uint8_t panel = 0; panel < 2; panel++) {
+    const std::string path = outDir + "/screen" + std::to_string(panel) + ".ppm";
+    if (tft.writePPM(panel, path.c_str())) printf("wrote %s\n", path.c_str());
+    else ok = false;
+  }
+  return ok ? 0 : 1;
+}
+
+#endif // PIO_UNIT_TESTING
@@ -0,0 +1,181 @@
+#include <TFT_eSPI.h>
+#include <Scooter.h>
+#include <trig_utils.h>
+#include <arc_raster.h>
+#include <frame_profiler.h>
+#include <palette.h>
+#include <shock_gradient.h>
+#include <screens.h>
+
+
+//Sensor Variables
+int shockSensorBackValue = 0;
+int shockSensorFrontValue = 0;
+
+int gForceValueX = 0;
+int gForceValueZ = 0;
+
+float tiltAngleValue = 0.0;
+int compassValue = 0; //From 0-360 degrees
+
+//Static layers of screen 0, rendered once and copied into img every frame
+LayerCache screen0Layers(&tft, TFT_BLACK, &roundMask);
+
+//Decoded map tiles for screen 1
+maptiles::TileCache<16> mapTiles;
+//Map window shown on screen 1, centred on the rider
+MapRenderer<16> mapRenderer(mapTiles);
+MapView mapView = { MAP_WIDTH / 2, MAP_HEIGHT / 2, 0, 0 };
+//Turn the map with the compass so the direction of travel is up, false for north up
+bool mapHeadingUp = true;
+
+//Threshold source of the shock gradient, and a fixed seed for reproducible XORSHIFT frames (0: free running)
+shocknoise::Mode shockNoiseMode = shocknoise::DITHER;
+uint32_t shockNoiseSeed = 0;
+static shocknoise::XorShift32 shockRng;
+
+
+// Static layers of screen 0 (see screen0Layers)
+/////////////////////////////////////////////////
+void drawReferenceNeedle(TFT_eSprite &spr) {
+  const int cx = 120;
+  const int cy = 120;
+  const int needleBaseR = 81;
+  const int needleTipR = 90;
+  //Draw Referencce needle (fixed North position)
+  spr.fillTriangle(
+    trig::polarX(cx, needleBaseR, -90 + 5), trig::polarY(cy, needleBaseR, -90 + 5),
+    trig::polarX(cx, needleBaseR, -90 - 5), trig::polarY(cy, needleBaseR, -90 - 5),
+    trig::polarX(cx, needleTipR, 270), trig::polarY(cy, needleTipR, 270),
+    palette::NEEDLE.c565
+  );
+}
+void drawScooterBitmap(TFT_eSprite &spr) {
+  //Draw Scooter Bitmap in the center, on top of the shock gradients
+  spr.drawBitmap(80, 70, scooterBitmap, 80, 110, palette::SCOOTER.c565); // Draw scooter bitmap at (80,70)
+}
+bool prepareScreen0Layers() {
+  screen0Layers.addLayer(LayerCache::UNDER, drawReferenceNeedle);
+  screen0Layers.addLayer(LayerCache::OVER, drawScooterBitmap);
+  return screen0Layers.prepare(240, 240);
+}
+// Update screen 0 content
+// Screen 0 has shock sensors (BACK/FRONT), G-FORCE display, Optimal tilt angle calc, Compass (GPS)
+/////////////////////////////////////////////////
+void updateScreen0(TFT_eSprite &img, DirtyTracker &screen0Dirty) {
+  PROFILE_ZONE(PROF_SCREEN0);
+  //Clear screen to the cached static background (black + reference needle)
+  screen0Layers.beginFrame(img);
+
+  const int cx = 120;
+  const int cy = 120;
+  const int borderR = 90;
+  const int charR = 107;
+  const int markInnerR = 105;
+  const int markOuterR = 110;
+
+  //Boost angle Vars
+  int greenBoostAngle = 40;
+  int YellowBoostAngle = 60;
+  int redBoostAngle = 80;
+
+  // Draw Compass (GPS):
+  {
+    PROFILE_ZONE(PROF_COMPASS);
+    const char compassChars[4] = { 'N', 'S', 'E', 'W' };
+    const int compassAngles[4] = { -90, -270, 0, -180 };
+    const uint16_t compassColors[4] = {
+      palette::COMPASS_NORTH.c565, palette::COMPASS_OTHER.c565, palette::COMPASS_OTHER.c565, palette::COMPASS_OTHER.c565
+    }; // North in red
+    for (int c = 0; c < 4; c++) {
+      int x = trig::polarX(cx, charR, compassAngles[c] - compassValue);
+      int y = trig::polarY(cy, charR, compassAngles[c] - compassValue);
+      img.drawChar(x, y, compassChars[c], compassColors[c], palette::BACKGROUND.c565, 1.7);
+      screen0Dirty.mark(x, y, 6, 8); // GLCD font cell
+    }
+  }
+
+  // Draw line markers
+  {
+    PROFILE_ZONE(PROF_TICKS);
+    for (int i = 0; i < 360; i += 18) {
+      if (i % 90 != 0) { // Skip N, S, E, W
+        int sx = trig::polarX(cx, markInnerR, -i - compassValue);
+        int sy = trig::polarY(cy, markInnerR, -i - compassValue);
+        int ex = trig::polarX(cx, markOuterR, -i - compassValue);
+        int ey = trig::polarY(cy, markOuterR, -i - compassValue);
+        img.drawLine(sx, sy, ex, ey, palette::TICK.c565);
+        screen0Dirty.mark(min(sx, ex), min(sy, ey), abs(ex - sx) + 1, abs(ey - sy) + 1);
+      }
+    }
+  }
+
+  // Draw Bottom Boost Indicator
+  {
+    PROFILE_ZONE(PROF_BOOST_ARC);
+    screen0Layers.restore(img, 0, 120, 240, 120); // Clear the bottom half back to the background (placeholder for boost indicator)
+    //Draw an arc using the boost value (placeholder logic)
+    int boostAngle = map(gForceValueZ, 0, 100, 0, 80); // Map gForceValue (0-100) to angle (0-180)
+    // 11px thick arc mirrored either side of straight down, flaring out by 7px towards
+    // the end of the sweep, with the outermost left end made slightly thicker
+    const ArcBand boostBands[] = {
+      { (int16_t)greenBoostAngle, palette::BOOST_LOW.c332 },
+      { (int16_t)YellowBoostAngle, palette::BOOST_MID.c332 },
+      { (int16_t)redBoostAngle, palette::BOOST_HIGH.c332 },
+    };
+    FlaredArc boostArc = { cx, cy, borderR + 20, 11, (int16_t)boostAngle, 7, 4, boostBands, 3 };
+    SpanTarget screen0 = spanTarget(img, &screen0Dirty.region(), &roundMask);
+    drawFlaredArc(screen0, boostArc);
+  }
+
+  // Draw a triangle on the scooter wheels and increase red color from green as shock sensors increase
+  // Wheel positions are chosen relative to the scooter bitmap drawn at (80,70) with size 80x110.
+  // Adjust leftWheelX/Y and rightWheelX/Y if your bitmap positions differ.
+  {
+    PROFILE_ZONE(PROF_SHOCK);
+    // Clamp raw analog values to expected range then map to 0..100
+    int backVal = constrain(shockSensorBackValue, 0, 256);
+    int frontVal = constrain(shockSensorFrontValue, 0, 256);
+    int backPct = map(backVal, 0, 256, 0, 100);
+    int frontPct = map(frontVal, 0, 256, 0, 100);
+
+    // Draw wheel color blocks
+    if (backPct > 0) {
+      screen0Dirty.mark(120 - SHOCK_REACH, 120, 2 * SHOCK_REACH + 1, SHOCK_ROWS);
+      screen0Dirty.mark(120 - SHOCK_REACH, 165, 2 * SHOCK_REACH + 1, SHOCK_ROWS);
+    }
+    if (shockNoiseSeed) shockRng = shocknoise::XorShift32(shockNoiseSeed);
+    const ShockGradient shock = {
+      120, 165, 120, (uint8_t)backPct, palette::shock332(backPct), palette::shock332(frontPct)
+    };
+    SpanTarget screen0 = spanTarget(img);
+    drawShockGradient(screen0, shock, shockNoiseMode, shockRng);
+  }
+
+
+  //Draw cached overlays (scooter bitmap) on top
+  {
+    PROFILE_ZONE(PROF_BITMAP);
+    screen0Layers.endFrame(img);
+  }
+  // The scheduler sends the changed parts of the sprite to the TFT
+  // Shock Sensors (BACK/FRONT):
+  // Analog read from 0 to 4095 (12 bits) from the shock sensors
+  // Map to 0 to 100% for display
+  // Rand gen values to create gradient effect (increase near wheels and increase when shock detected)
+  // Write individual pixels with randnum (1/0)
+
+
+}
+void updateScreen1(TFT_eSprite &img2, DirtyTracker &screen1Dirty) {
+  PROFILE_ZONE(PROF_SCREEN1);
+  //Draw the map window around mapView, clipped to the round panel
+  {
+    PROFILE_ZONE(PROF_MAP);
+    SpanTarget screen1 = spanTarget(img2, &screen1Dirty.region(), &roundMask);
+    mapRenderer.render(screen1, mapView, palette::MAP_INDEX_FG, palette::MAP_INDEX_BG);
+  }
+  //Rider position marker
+  img2.fillCircle(120, 120, 4, palette::RIDER_INDEX);
+  // Not animated, the scheduler only redraws it when the view changes (see setMapView)
+}
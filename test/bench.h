@@ -0,0 +1,37 @@
+#pragma once
+#include <stdarg.h>
+#include <stdio.h>
+#include <chrono>
+#include <unity.h>
+
+// Timing for the benchmark tests. Host numbers only compare code paths against
+// each other; the absolute times on the ESP32-S3 differ.
+
+namespace bench {
+
+// Microseconds per call of fn(), over `reps` calls
+template <typename Fn>
+double microsPer(int reps, Fn fn) {
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < reps; i++) fn();
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(end - start).count() / reps;
+}
+
+// Print a result line with the test output
+inline void report(const char *fmt, ...) {
+  char line[200];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(line, sizeof(line), fmt, args);
+  va_end(args);
+  TEST_MESSAGE(line);
+}
+
+// Keep a result alive so the compiler can't drop the work that produced it
+template <typename T>
+inline void keep(const T &value) {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+} // namespace bench
@@ -0,0 +1,156 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <ble_link.h>
+#include <ble_session.h>
+#include <ble_setup_gate.h>
+#include <shock_noise.h>
+
+// Stand-in for the NimBLE stack in simulated time, for the BLE suites. The
+// peer advertises as `peerAddr` while `peerUp`, found 100-350 ms into a scan;
+// connects to it take 20-120 ms (its next advertisement) once it is up, and
+// fail at the requested timeout if it stays away, for any other address, or
+// while `failConnects` is set. Setup takes 150 ms (6 s, past the link's
+// timeout, one time in `hangEvery`) on a pretend worker, allocates the remote
+// attributes and resolves the characteristic into a session, as NimBleStack
+// does, and reports failure instead for the first `failSetups`. Who frees
+// them, release() or the worker when it finishes, is decided by the same
+// BleSetupGate NimBleStack uses. disconnect() drops the link at once, and its
+// DISCONNECTED follows `disconnectDelayMs` later. Calls made in a state the
+// real stack would refuse are counted.
+class FakeBleStack : public BleStack {
+public:
+  FakeBleStack(BleLink &link, uint32_t seed = 99) : _link(link), _rng(seed) {}
+  ~FakeBleStack() { freeAttributes(); }
+
+  bool peerUp = true;
+  BleAddress peerAddr = { { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 }, 1 };
+  uint32_t failConnects = 0; // fail this many connects even with the peer up
+  uint32_t failSetups = 0;
+  uint32_t disconnectDelayMs = 0;
+  uint8_t hangEvery = 0;
+  uint32_t misuse = 0;
+  uint32_t connections = 0, releases = 0, deferredReleases = 0;
+  int32_t liveAttributes = 0, maxLiveAttributes = 0;
+
+  bool startScan(uint32_t durationMs) override {
+    if (_scanning || _connected || _connecting) misuse++;
+    _scanning = true;
+    _scanEnd = _now + durationMs;
+    _foundAt = _now + 100 + _rng.below(250);
+    return true;
+  }
+  void stopScan() override { _scanning = false; }
+  bool connect(const BleAddress &peer, uint32_t timeoutMs) override {
+    if (_scanning || _connected || _connecting) misuse++;
+    _connecting = true;
+    _connectFails = failConnects || memcmp(&peer, &peerAddr, sizeof(peer));
+    if (failConnects) failConnects--;
+    _connectAt = _now + 20 + _rng.below(100);
+    _connectDeadline = _now + timeoutMs;
+    return true;
+  }
+  bool setup() override {
+    if (!_connected) misuse++;
+    if (!_gate.beginSetup()) return false;
+    // discovery builds the attribute tables as it goes: a fresh set per
+    // connection, so one not released by the next is leaked
+    _attributes = new FakeAttributes();
+    if (++liveAttributes > maxLiveAttributes) maxLiveAttributes = liveAttributes;
+    _setupAt = _now + (hangEvery && !_rng.below(hangEvery) ? 6000 : 150);
+    _setupFails = failSetups > 0;
+    if (failSetups) failSetups--;
+    _setup = BLE_SETUP_BUSY;
+    return true;
+  }
+  BleSetup setupState() override { return _setup; }
+  const BleSession<const uint16_t> &session() const { return _session; }
+
+  void disconnect() override {
+    _connecting = false;
+    if (_connected) dropLink(disconnectDelayMs);
+  }
+
+  void release() override {
+    releases++;
+    if (_gate.release()) freeAttributes();
+    else deferredReleases++;
+  }
+
+  // Advance to `now`, delivering whatever the radio would have reported
+  void run(uint32_t now) {
+    _now = now;
+    if (_disconnectAt && now >= _disconnectAt) {
+      _disconnectAt = 0;
+      _link.post(BLE_DISCONNECTED);
+    }
+    if (_scanning && peerUp && now >= _foundAt) {
+      BleEvent e = {};
+      e.type = BLE_FOUND;
+      e.addr = peerAddr;
+      _link.post(e);
+      _foundAt = UINT32_MAX; // one report per scan
+    }
+    if (_scanning && now >= _scanEnd) {
+      _scanning = false;
+      _link.post(BLE_SCAN_END);
+    }
+    if (peerUp && !_peerWasUp) _connectAt = now + 20 + _rng.below(100); // its first advertisement
+    _peerWasUp = peerUp;
+    if (_connecting && !_connectFails && peerUp && now >= _connectAt) {
+      _connecting = false;
+      _connected = true;
+      connections++;
+      _link.post(BLE_CONNECTED);
+    } else if (_connecting && now >= _connectDeadline) {
+      _connecting = false;
+      _link.post(BLE_CONNECT_FAILED);
+    }
+    if (_gate.busy() && now >= _setupAt) {
+      if (_connected && _setupFails) _setup = BLE_SETUP_FAILED;
+      else if (_connected) {
+        if (!_session.get()) {
+          _session.lookup(); // service
+          _session.lookup(); // characteristic
+          _session.bind(&_attributes->characteristic);
+        }
+        _setup = BLE_SETUP_OK;
+      }
+      if (_gate.endSetup()) freeAttributes();
+    }
+    if (_connected && !peerUp) dropLink();
+  }
+
+private:
+  struct FakeAttributes {
+    uint16_t characteristic = 0x2A;
+    uint8_t table[512] = {}; // services, descriptors, cached values
+  };
+
+  void freeAttributes() {
+    _session.invalidate();
+    if (!_attributes) return;
+    delete _attributes;
+    _attributes = nullptr;
+    liveAttributes--;
+  }
+
+  void dropLink(uint32_t delayMs = 0) {
+    _connected = false;
+    _session.invalidate();
+    _setup = BLE_SETUP_FAILED;
+    if (delayMs) _disconnectAt = _now + delayMs;
+    else _link.post(BLE_DISCONNECTED);
+  }
+
+  BleLink &_link;
+  shocknoise::XorShift32 _rng;
+  uint32_t _now = 0;
+  bool _scanning = false, _connecting = false, _connected = false, _connectFails = false, _setupFails = false;
+  bool _peerWasUp = true;
+  uint32_t _scanEnd = 0, _foundAt = 0, _connectAt = 0, _connectDeadline = 0, _setupAt = 0, _disconnectAt = 0;
+  BleSetup _setup = BLE_SETUP_BUSY;
+  BleSetupGate _gate;
+  FakeAttributes *_attributes = nullptr;
+  BleSession<const uint16_t> _session;
+};
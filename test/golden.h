@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <unity.h>
+
+// Golden-image checks for the native tests (pio test -e native).
+// Expected images are committed under test/golden/. After an intended change
+// in rendering, rerun with UPDATE_GOLDEN=1 in the environment to rewrite them,
+// and look at the new images before committing. On a mismatch the rendered
+// image is written next to the golden one as <name>.actual for comparison.
+
+namespace golden {
+
+// test/golden/<name>, located from this header so the working directory doesn't matter
+inline std::string path(const std::string &name) {
+  const std::string file = __FILE__;
+  const size_t slash = file.find_last_of("/\\");
+  return (slash == std::string::npos ? std::string(".") : file.substr(0, slash)) + "/golden/" + name;
+}
+
+inline bool load(const std::string &file, std::vector<uint8_t> &out) {
+  FILE *f = fopen(file.c_str(), "rb");
+  if (!f) return false;
+  out.clear();
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+inline bool save(const std::string &file, const std::vector<uint8_t> &data) {
+  FILE *f = fopen(file.c_str(), "wb");
+  if (!f) return false;
+  const bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+  return fclose(f) == 0 && ok;
+}
+
+// Binary PGM of one byte per pixel, e.g. the palette indices of a 4-bit sprite
+inline std::vector<uint8_t> pgm(uint16_t w, uint16_t h, uint8_t maxValue, const std::vector<uint8_t> &pixels) {
+  char header[32];
+  const int n = snprintf(header, sizeof(header), "P5\n%u %u\n%u\n", w, h, maxValue);
+  std::vector<uint8_t> out(header, header + n);
+  out.insert(out.end(), pixels.begin(), pixels.end());
+  return out;
+}
+
+// Fail unless `image` (a whole image file) is byte for byte the golden one
+inline void check(const std::string &name, const std::vector<uint8_t> &image) {
+  const std::string file = path(name);
+  if (getenv("UPDATE_GOLDEN")) {
+    TEST_ASSERT_TRUE_MESSAGE(save(file, image), ("cannot write " + file).c_str());
+    TEST_MESSAGE(("updated " + file).c_str());
+    return;
+  }
+  std::vector<uint8_t> expected;
+  TEST_ASSERT_TRUE_MESSAGE(load(file, expected), ("no " + file + ", run with UPDATE_GOLDEN=1 to create it").c_str());
+  size_t diff = 0, first = 0;
+  for (size_t i = 0; i < expected.size() && i < image.size(); i++) {
+    if (expected[i] != image[i] && !diff++) first = i;
+  }
+  if (expected.size() == image.size() && !diff) return;
+  save(file + ".actual", image);
+  char msg[160];
+  snprintf(msg, sizeof(msg), "%s: %zu bytes differ from offset %zu, sizes %zu/%zu (see .actual)", name.c_str(), diff,
+           first, image.size(), expected.size());
+  TEST_FAIL_MESSAGE(msg);
+}
+
+} // namespace golden
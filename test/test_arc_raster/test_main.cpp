@@ -0,0 +1,175 @@
+// Boost arc rasterizer against two per-pixel renderings: the drawPixel loop it
+// replaced in updateScreen0(), and a reference that evaluates the same shape
+// independently for every pixel. Also times both ways of drawing the gauge.
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <unity.h>
+#include <TFT_eSPI.h>
+#include <arc_raster.h>
+#include <palette.h>
+#include <sprite_spans.h>
+#include "../bench.h"
+
+static const int CX = 120, CY = 120, BORDER_R = 90;
+static const int GREEN_DEG = 40, YELLOW_DEG = 60, RED_DEG = 80;
+
+static TFT_eSPI tftHost;
+static TFT_eSprite oldArc(&tftHost), newArc(&tftHost), reference(&tftHost);
+
+static const ArcBand bands[] = {
+  { GREEN_DEG, palette::BOOST_LOW.c332 },
+  { YELLOW_DEG, palette::BOOST_MID.c332 },
+  { RED_DEG, palette::BOOST_HIGH.c332 },
+};
+
+static FlaredArc gauge(int boostAngle) {
+  return { CX, CY, BORDER_R + 20, 11, (int16_t)boostAngle, 7, 4, bands, 3 };
+}
+
+static double radiansOf(double deg) { return deg * M_PI / 180.0; }
+
+// The gauge as updateScreen0() drew it before arc_raster.h, colours as palette.h has them
+static void drawOldArc(TFT_eSprite &img, int boostAngle) {
+  for (int b = 0; b <= 10; b++) {
+    for (int a = 0; a <= boostAngle; a++) {
+      float extraRadius = (boostAngle > 0) ? ((float)a / boostAngle) * 7.0f : 0.0f;
+      float r = BORDER_R + 20 + b + extraRadius;
+      int xi = (int)(cos(radiansOf(90 - a)) * r + CX);
+      int yi = (int)(sin(radiansOf(90 - a)) * r + CY);
+      if (a < GREEN_DEG) img.drawPixel(xi, yi, palette::BOOST_LOW.c565);
+      else if (a < YELLOW_DEG) img.drawPixel(xi, yi, palette::BOOST_MID.c565);
+      else if (a < RED_DEG) img.drawPixel(xi, yi, palette::BOOST_HIGH.c565);
+    }
+    for (int a = 0; a <= boostAngle; a++) {
+      float ang = radiansOf(90 + a);
+      float extraRadius = (boostAngle > 0) ? ((float)a / boostAngle) * 7.0f : 0.0f;
+      if (a >= boostAngle - 1) extraRadius += 4.0f;
+      float r = BORDER_R + 20 + b + extraRadius;
+      int xi = (int)(cos(ang) * r + CX);
+      int yi = (int)(sin(ang) * r + CY);
+      if (a < GREEN_DEG) img.drawPixel(xi, yi, palette::BOOST_LOW.c565);
+      else if (a < YELLOW_DEG) img.drawPixel(xi, yi, palette::BOOST_MID.c565);
+      else if (a < RED_DEG) img.drawPixel(xi, yi, palette::BOOST_HIGH.c565);
+    }
+  }
+}
+
+// FlaredArc's shape, evaluated on its own for every pixel of the sprite: a pixel
+// centre is on the arc if it lies in the window of a degree k within the sweep,
+// between the rays at k - 0.5 and k + 0.5 degrees from straight down (the Q15
+// rays, so ties on a ray fall the same way), and its distance from the centre
+// lies between degree k's inner and outer radius
+static void drawReferenceArc(TFT_eSprite &img, const FlaredArc &arc) {
+  uint8_t *px = (uint8_t *)img.getPointer();
+  for (int y = 0; y < img.height(); y++) {
+    for (int x = 0; x < img.width(); x++) {
+      const double dx = x + 0.5 - arc.cx, dy = y + 0.5 - arc.cy;
+      if (dy <= 0) continue;
+      // doubled coordinates of the pixel centre, whole numbers
+      const int32_t X = (int32_t)fabs(2 * dx), Y = (int32_t)(2 * dy);
+      int k = 0;
+      while (k <= ARC_MAX_SWEEP && X * trig::cosQ15Steps(4 * k + 2) >= Y * trig::sinQ15Steps(4 * k + 2)) k++;
+      if (k > arc.sweep || k >= arc.bands[arc.bandCount - 1].untilDeg) continue;
+      // radii in 1/16 px, rounded down like the rasterizer's table
+      const int tip = dx < 0 && k >= arc.sweep - 1 ? arc.leftTip : 0;
+      const double rin = ((arc.innerR << 4) + (arc.sweep > 0 ? k * arc.flare * 16 / arc.sweep : 0)) / 16.0;
+      const double rout = rin + arc.thickness + tip;
+      const double d = sqrt(dx * dx + dy * dy);
+      if (d < rin || d >= rout) continue;
+      uint8_t color = 0;
+      for (int b = arc.bandCount - 1; b >= 0; b--) {
+        if (k < arc.bands[b].untilDeg) color = arc.bands[b].color;
+      }
+      px[y * img.width() + x] = color;
+    }
+  }
+}
+
+static void clear(TFT_eSprite &spr) { spr.fillSprite(TFT_BLACK); }
+
+void setUp(void) {
+  clear(oldArc);
+  clear(newArc);
+  clear(reference);
+}
+void tearDown(void) {}
+
+static void test_matches_reference_rendering(void) {
+  for (int boost = 0; boost <= 90; boost++) {
+    setUp();
+    SpanTarget target = spanTarget(newArc);
+    drawFlaredArc(target, gauge(boost));
+    drawReferenceArc(reference, gauge(boost));
+    const uint8_t *a = (const uint8_t *)newArc.getPointer(), *b = (const uint8_t *)reference.getPointer();
+    for (int i = 0; i < 240 * 240; i++) {
+      if (a[i] != b[i]) {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "boost %d: pixel (%d, %d) is 0x%02x, reference 0x%02x", boost, i % 240, i / 240,
+                 a[i], b[i]);
+        TEST_FAIL_MESSAGE(msg);
+      }
+    }
+  }
+}
+
+// The old loop truncated its float coordinates, which moves pixels by up to one
+// towards the centre line and the top of the panel, so every pixel it drew must
+// have a pixel of the same colour within one pixel in the new arc. The pixels
+// the new arc adds are the holes between the old loop's dots.
+static void test_covers_old_arc(void) {
+  uint32_t oldPixels = 0, exact = 0, newPixels = 0;
+  for (int boost = 0; boost <= 80; boost++) {
+    setUp();
+    drawOldArc(oldArc, boost);
+    SpanTarget target = spanTarget(newArc);
+    drawFlaredArc(target, gauge(boost));
+    const uint8_t *a = (const uint8_t *)oldArc.getPointer(), *b = (const uint8_t *)newArc.getPointer();
+    for (int i = 0; i < 240 * 240; i++) {
+      if (b[i]) newPixels++;
+      if (!a[i]) continue;
+      oldPixels++;
+      if (a[i] == b[i]) {
+        exact++;
+        continue;
+      }
+      const int x = i % 240, y = i / 240;
+      bool near = false;
+      for (int ny = y - 1; ny <= y + 1 && !near; ny++) {
+        for (int nx = x - 1; nx <= x + 1 && !near; nx++) {
+          near = nx >= 0 && ny >= 0 && nx < 240 && ny < 240 && b[ny * 240 + nx] == a[i];
+        }
+      }
+      if (!near) {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "boost %d: old pixel (%d, %d) 0x%02x has no match in the new arc", boost, x, y, a[i]);
+        TEST_FAIL_MESSAGE(msg);
+      }
+    }
+  }
+  bench::report("boost 0..80: %u old pixels (%u at the same place), %u new", (unsigned)oldPixels, (unsigned)exact,
+                (unsigned)newPixels);
+}
+
+static void bench_full_gauge(void) {
+  const int frames = 2000;
+  const double oldUs = bench::microsPer(frames, [] { drawOldArc(oldArc, 80); });
+  const double newUs = bench::microsPer(frames, [] {
+    SpanTarget target = spanTarget(newArc);
+    drawFlaredArc(target, gauge(80));
+  });
+  bench::report("boost arc at 80 degrees: drawPixel loop %.1f us, span rasterizer %.1f us", oldUs, newUs);
+  TEST_ASSERT_TRUE(newUs < oldUs);
+}
+
+int main() {
+  for (TFT_eSprite *spr : { &oldArc, &newArc, &reference }) {
+    spr->setColorDepth(8);
+    spr->createSprite(240, 240);
+  }
+  UNITY_BEGIN();
+  RUN_TEST(test_matches_reference_rendering);
+  RUN_TEST(test_covers_old_arc);
+  RUN_TEST(bench_full_gauge);
+  return UNITY_END();
+}
@@ -0,0 +1,143 @@
+// Connection state machine over 3 minutes of simulated riding, ticked every
+// 5 ms like loop(): the link drops at 20 s and comes back at 80 s, drops again
+// at 100 s and comes back at 102 s to two failed connects. Every tick must
+// return at once, the link must be subscribed again after each restore, and
+// the waits between attempts must double up to the cap. Every tick while
+// subscribed reads through the session's cached handle, so GATT lookups happen
+// once per connection and none in the last minute, with the link steady.
+#include <unity.h>
+#include <ble_link.h>
+#include <ble_session.h>
+#include "../bench.h"
+#include "../fake_ble_stack.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+struct Ride {
+  uint32_t subscribedAt[4] = {};
+  uint32_t subscribes = 0, waits = 0, badWaits = 0;
+  uint32_t reads = 0, misses = 0, lookupsPerMinute = 0;
+  uint32_t connects = 0, lookups = 0, misuse = 0;
+  double maxTickUs = 0;
+};
+
+static Ride ride() {
+  Ride r;
+  BleLink link;
+  FakeBleStack stack(link);
+  link.begin(&stack, 0);
+  BleState last = link.state();
+  uint32_t lastWait = 0;
+  PerMinute lookupRate;
+  for (uint32_t now = 0; now <= 180000; now += 5) {
+    if (now == 20000 || now == 100000) stack.peerUp = false;
+    if (now == 80000 || now == 102000) stack.peerUp = true;
+    if (now == 102000) stack.failConnects = 2;
+    stack.run(now);
+    const double us = bench::microsPer(1, [&] { link.tick(now); });
+    if (us > r.maxTickUs) r.maxTickUs = us;
+    if (link.subscribed()) {
+      if (stack.session().get()) r.reads++;
+      else r.misses++;
+    }
+    if (now % 1000 == 0) r.lookupsPerMinute = lookupRate.update(now, stack.session().lookups());
+    if (link.state() == last) continue;
+    last = link.state();
+    if (last == BLE_SUBSCRIBED && r.subscribes < 4) r.subscribedAt[r.subscribes++] = now;
+    if (last == BLE_BACKOFF) {
+      // each wait doubles the one before, unless the link was up in between
+      const uint32_t wait = link.backoffMs();
+      const bool reset = wait == BleLink::BACKOFF_MIN_MS;
+      if (!reset && wait != (lastWait * 2 < BleLink::BACKOFF_MAX_MS ? lastWait * 2 : BleLink::BACKOFF_MAX_MS)) r.badWaits++;
+      lastWait = wait;
+      r.waits++;
+    }
+  }
+  r.connects = link.connects();
+  r.lookups = stack.session().lookups();
+  r.misuse = stack.misuse;
+  return r;
+}
+
+static void test_reconnects_after_each_restore(void) {
+  const Ride r = ride();
+  TEST_ASSERT_EQUAL_UINT32(3, r.subscribes);
+  TEST_ASSERT_LESS_THAN_UINT32(1000, r.subscribedAt[0]);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(80000, r.subscribedAt[1]);
+  TEST_ASSERT_LESS_THAN_UINT32(80000 + 30000 + 1000, r.subscribedAt[1]);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(102000, r.subscribedAt[2]);
+  TEST_ASSERT_LESS_THAN_UINT32(102000 + 20000, r.subscribedAt[2]);
+  TEST_ASSERT_EQUAL_UINT32(0, r.misuse);
+  bench::report("subscribed at %.1f s, %.1f s and %.1f s", r.subscribedAt[0] / 1000.0, r.subscribedAt[1] / 1000.0,
+                r.subscribedAt[2] / 1000.0);
+}
+
+static void test_backoff_doubles_to_the_cap(void) {
+  const Ride r = ride();
+  TEST_ASSERT_GREATER_THAN_UINT32(0, r.waits);
+  TEST_ASSERT_EQUAL_UINT32(0, r.badWaits);
+}
+
+static void test_tick_never_blocks(void) {
+  const Ride r = ride();
+  TEST_ASSERT_TRUE(r.maxTickUs < 1000);
+  bench::report("tick max %.1f us", r.maxTickUs);
+}
+
+// GATT lookups once per connection, none while the link stays up
+static void test_session_caches_the_characteristic(void) {
+  const Ride r = ride();
+  TEST_ASSERT_EQUAL_UINT32(0, r.misses);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, r.reads);
+  TEST_ASSERT_EQUAL_UINT32(2 * r.connects, r.lookups);
+  TEST_ASSERT_EQUAL_UINT32(0, r.lookupsPerMinute);
+}
+
+// Setup fails on the first link, and its DISCONNECTED only arrives once the
+// backoff is over and the direct attempt is connecting: that must just release
+// the old link, and the new one subscribe with no second failure
+static void test_late_disconnect_spares_next_attempt(void) {
+  BleLink link;
+  FakeBleStack stack(link);
+  stack.failSetups = 1;
+  stack.disconnectDelayMs = BleLink::BACKOFF_MIN_MS + 10;
+  link.setKnownPeer(stack.peerAddr);
+  link.begin(&stack, 0);
+  bool lateWhileConnecting = false;
+  for (uint32_t now = 0; now <= 3000; now += 5) {
+    stack.run(now);
+    const BleState before = link.state();
+    const uint32_t releases = stack.releases;
+    link.tick(now);
+    if (stack.releases != releases && before == BLE_CONNECTING) lateWhileConnecting = true;
+  }
+  TEST_ASSERT_TRUE(lateWhileConnecting);
+  TEST_ASSERT_TRUE(link.subscribed());
+  TEST_ASSERT_EQUAL_UINT32(1, link.connects());
+  TEST_ASSERT_EQUAL_UINT32(1, link.failures());
+  TEST_ASSERT_EQUAL_UINT32(1, stack.releases);
+  TEST_ASSERT_EQUAL_INT32(1, stack.liveAttributes);
+  TEST_ASSERT_EQUAL_UINT32(0, stack.misuse);
+}
+
+static void test_per_minute(void) {
+  PerMinute rate;
+  TEST_ASSERT_EQUAL_UINT32(5, rate.update(1000, 5));
+  TEST_ASSERT_EQUAL_UINT32(7, rate.update(25000, 7));
+  TEST_ASSERT_EQUAL_UINT32(8, rate.update(59000, 8));
+  // the first bucket has rolled out
+  TEST_ASSERT_EQUAL_UINT32(3, rate.update(61000, 8));
+  TEST_ASSERT_EQUAL_UINT32(0, rate.update(200000, 8));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_reconnects_after_each_restore);
+  RUN_TEST(test_backoff_doubles_to_the_cap);
+  RUN_TEST(test_tick_never_blocks);
+  RUN_TEST(test_session_caches_the_characteristic);
+  RUN_TEST(test_late_disconnect_spares_next_attempt);
+  RUN_TEST(test_per_minute);
+  return UNITY_END();
+}
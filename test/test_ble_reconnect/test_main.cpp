@@ -0,0 +1,96 @@
+// Time from power-on (or from losing the link) to subscribed, over 200 runs
+// of each path: no saved controller, so scan; saved controller, connected
+// directly; saved controller that has since changed address, so the direct
+// attempt times out and a scan follows; and the link dropping for a second,
+// timed from the controller advertising again. The direct paths must average
+// well under a second.
+#include <unity.h>
+#include <ble_link.h>
+#include "../bench.h"
+#include "../fake_ble_stack.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+enum Path { SCAN, DIRECT, PEER_MOVED, LINK_LOST };
+
+struct Timing {
+  double avgMs;
+  uint32_t worstMs, scans, wrongConnects;
+};
+
+static Timing reconnect(Path path) {
+  const uint32_t want = path == LINK_LOST ? 2 : 1;
+  Timing t = {};
+  uint32_t total = 0;
+  for (uint32_t run = 0; run < 200; run++) {
+    BleLink link;
+    FakeBleStack stack(link, run * 2654435761u + 1);
+    BleAddress saved = stack.peerAddr;
+    if (path == PEER_MOVED) saved.val[0] ^= 0xFF;
+    if (path != SCAN) link.setKnownPeer(saved);
+    uint32_t now = 0, start = 0;
+    link.begin(&stack, now);
+    for (uint32_t connects = 0; now < 60000; now += 5) {
+      if (path == LINK_LOST && connects == 1 && !start && now >= 5000) {
+        stack.peerUp = false;
+        start = now + 1000;
+      }
+      if (path == LINK_LOST && !stack.peerUp && now >= start) stack.peerUp = true;
+      stack.run(now);
+      link.tick(now);
+      if (link.subscribed() && link.connects() != connects) {
+        connects = link.connects();
+        if (connects == want) break;
+      }
+    }
+    const uint32_t ms = now - start;
+    total += ms;
+    if (ms > t.worstMs) t.worstMs = ms;
+    if (!link.direct()) t.scans++;
+    if (link.connects() != want) t.wrongConnects++;
+  }
+  t.avgMs = total / 200.0;
+  return t;
+}
+
+static void test_scan_with_nothing_saved(void) {
+  const Timing t = reconnect(SCAN);
+  TEST_ASSERT_EQUAL_UINT32(0, t.wrongConnects);
+  TEST_ASSERT_EQUAL_UINT32(200, t.scans);
+  bench::report("scan, nothing saved: avg %.0f ms, max %u ms", t.avgMs, t.worstMs);
+}
+
+static void test_direct_to_saved_peer(void) {
+  const Timing direct = reconnect(DIRECT), scan = reconnect(SCAN);
+  TEST_ASSERT_EQUAL_UINT32(0, direct.wrongConnects);
+  TEST_ASSERT_EQUAL_UINT32(0, direct.scans);
+  TEST_ASSERT_TRUE(direct.avgMs < 1000);
+  TEST_ASSERT_TRUE(direct.avgMs < scan.avgMs);
+  bench::report("direct to saved peer: avg %.0f ms, max %u ms (scan %.0f ms)", direct.avgMs, direct.worstMs, scan.avgMs);
+}
+
+// The direct attempt times out, then a scan finds the new address
+static void test_saved_peer_moved(void) {
+  const Timing t = reconnect(PEER_MOVED);
+  TEST_ASSERT_EQUAL_UINT32(0, t.wrongConnects);
+  TEST_ASSERT_EQUAL_UINT32(200, t.scans);
+  bench::report("saved peer moved, direct then scan: avg %.0f ms, max %u ms", t.avgMs, t.worstMs);
+}
+
+static void test_link_lost_reconnects_directly(void) {
+  const Timing t = reconnect(LINK_LOST);
+  TEST_ASSERT_EQUAL_UINT32(0, t.wrongConnects);
+  TEST_ASSERT_EQUAL_UINT32(0, t.scans);
+  TEST_ASSERT_TRUE(t.avgMs < 1000);
+  bench::report("link lost 1 s, direct, from its return: avg %.0f ms, max %u ms", t.avgMs, t.worstMs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_scan_with_nothing_saved);
+  RUN_TEST(test_direct_to_saved_peer);
+  RUN_TEST(test_saved_peer_moved);
+  RUN_TEST(test_link_lost_reconnects_directly);
+  return UNITY_END();
+}
@@ -0,0 +1,274 @@
+// The scan filter: UUID parsing, a fuzz of the payload parser, and 200 scans
+// per setting over 40 advertisers starting at random phases, with the old
+// collect-for-10-s scan for comparison. The filter must never pick a decoy,
+// and the fast setting must find the controller in well under a second.
+#include <string.h>
+#include <unity.h>
+#include <ble_link.h>
+#include <ble_scan.h>
+#include <shock_noise.h>
+#include "../bench.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const char *const SERVICE = "c32cdd1f-baf2-46bc-87a1-69ab9637bfe0";
+
+// Advertising devices around the scooter for the scan filter: the controller
+// (connectable, the service in its advertisement, or only in its scan
+// response), phones and tags with names, 16-bit services and manufacturer data,
+// decoys (a beacon advertising the service but not connectable, the service
+// UUID one byte off) and malformed payloads.
+struct SimAdvertiser {
+  uint8_t adv[31];
+  uint8_t advLen;
+  uint8_t rsp[31];
+  uint8_t rspLen;
+  bool connectable;
+  bool target;
+  uint16_t intervalMs;
+  uint32_t next; // time of its next advertising event
+};
+
+static uint8_t adField(uint8_t *p, uint8_t at, uint8_t type, const uint8_t *data, uint8_t len) {
+  p[at] = len + 1;
+  p[at + 1] = type;
+  memcpy(p + at + 2, data, len);
+  return at + 2 + len;
+}
+
+static void makeAdvertiser(SimAdvertiser &d, uint8_t kind, const uint8_t uuid[16], shocknoise::XorShift32 &rng) {
+  static const uint8_t flags[] = { 0x06 };
+  uint8_t other[16];
+  for (uint8_t i = 0; i < 16; i++) other[i] = (uint8_t)rng.next();
+  d = SimAdvertiser();
+  d.advLen = adField(d.adv, 0, 0x01, flags, 1);
+  d.connectable = true;
+  d.intervalMs = 20 + 4 * rng.below(245);
+  switch (kind) {
+  case 0: // the controller
+  case 1: // the controller, service UUID in the scan response
+    d.target = true;
+    if (kind == 0) d.advLen = adField(d.adv, d.advLen, 0x07, uuid, 16);
+    else d.rspLen = adField(d.rsp, 0, 0x07, uuid, 16);
+    d.advLen = adField(d.adv, d.advLen, 0x09, (const uint8_t *)"Scooter", 7);
+    d.intervalMs = 100 + 2 * rng.below(200);
+    break;
+  case 2: // beacon with the service, not connectable
+    d.connectable = false;
+    d.advLen = adField(d.adv, d.advLen, 0x07, uuid, 16);
+    break;
+  case 3: // near miss
+    memcpy(other, uuid, 16);
+    other[rng.below(16)] ^= 0x01;
+    d.advLen = adField(d.adv, d.advLen, 0x06, other, 16);
+    break;
+  case 4: // some other 128-bit service
+    d.advLen = adField(d.adv, d.advLen, 0x07, other, 16);
+    break;
+  case 5: // malformed: the length runs past the end, over a copy of the UUID
+    d.advLen = adField(d.adv, d.advLen, 0x07, uuid, 16);
+    d.adv[3] = 30;
+    break;
+  default: // phone or tag: 16-bit services, name, manufacturer data
+    d.advLen = adField(d.adv, d.advLen, 0x03, other, 2 * (1 + rng.below(3)));
+    d.advLen = adField(d.adv, d.advLen, 0xFF, other + 6, 4 + rng.below(6));
+    if (rng.below(2)) d.rspLen = adField(d.rsp, 0, 0x09, (const uint8_t *)"Phone", 5);
+    break;
+  }
+}
+
+// One scan over a stream of advertisers: the radio hears an advertising event
+// only inside its window, the controller's duplicate filter reports each
+// device once (or every event, without it), and matching either stops at the
+// first hit or collects for the whole scan and filters afterwards as the old
+// blocking scan did. Returns the time the controller was picked, or 0.
+struct ScanRun {
+  uint32_t foundMs;
+  uint32_t parsed;    // payloads run through the filter
+  uint32_t falseHits; // picked something that isn't the controller
+};
+
+static ScanRun simulateScan(SimAdvertiser *devs, uint8_t count, const BleScanConfig &cfg, uint32_t durationMs,
+                            bool stopAtMatch, bool filterDuplicates, const uint8_t uuid[16], shocknoise::XorShift32 &rng) {
+  ScanRun run = {};
+  bool reported[64] = {};
+  uint8_t payload[62];
+  for (;;) {
+    uint8_t d = 0;
+    for (uint8_t i = 1; i < count; i++) {
+      if (devs[i].next < devs[d].next) d = i;
+    }
+    SimAdvertiser &dev = devs[d];
+    const uint32_t t = dev.next;
+    if (t > durationMs) break;
+    dev.next += dev.intervalMs + rng.below(11); // advDelay
+    if (t % cfg.intervalMs >= cfg.windowMs) continue; // radio not listening
+    if (filterDuplicates && reported[d]) continue;
+    reported[d] = true;
+    // passive scans never see the scan response
+    const uint8_t rspLen = cfg.active && dev.connectable ? dev.rspLen : 0;
+    memcpy(payload, dev.adv, dev.advLen);
+    memcpy(payload + dev.advLen, dev.rsp, rspLen);
+    run.parsed++;
+    if (!dev.connectable || !advertisesService(payload, dev.advLen + rspLen, uuid)) continue;
+    if (!dev.target) run.falseHits++;
+    if (!run.foundMs) run.foundMs = t ? t : 1;
+    if (stopAtMatch) return run;
+  }
+  if (!stopAtMatch && run.foundMs) run.foundMs = durationMs; // only acted on at the end
+  return run;
+}
+
+static void test_parse_uuid(void) {
+  uint8_t uuid[16];
+  TEST_ASSERT_TRUE(parseUuid128(SERVICE, uuid));
+  TEST_ASSERT_EQUAL_HEX8(0xE0, uuid[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xBF, uuid[1]);
+  TEST_ASSERT_EQUAL_HEX8(0xC3, uuid[15]);
+  TEST_ASSERT_FALSE(parseUuid128("c32cdd1f-baf2-46bc-87a1-69ab9637bfe", uuid));
+  TEST_ASSERT_FALSE(parseUuid128("c32cdd1f-baf2-46bc-87a1-69ab9637bfe0a", uuid));
+  TEST_ASSERT_FALSE(parseUuid128("x32cdd1f-baf2-46bc-87a1-69ab9637bfe0", uuid));
+  TEST_ASSERT_FALSE(parseUuid128("", uuid));
+}
+
+// Random payloads never read past their length (run with -fsanitize=address),
+// and a UUID planted in a well-formed field at the start is always found
+static void test_fuzz_payloads(void) {
+  uint8_t uuid[16];
+  parseUuid128(SERVICE, uuid);
+  shocknoise::XorShift32 rng(4242);
+  uint32_t planted = 0;
+  for (uint32_t i = 0; i < 100000; i++) {
+    uint8_t buf[62];
+    const uint8_t len = rng.below(63);
+    for (uint8_t b = 0; b < len; b++) buf[b] = (uint8_t)rng.next();
+    // exact-size copy, so reading past len is caught
+    uint8_t *payload = new uint8_t[len ? len : 1];
+    memcpy(payload, buf, len);
+    advertisesService(payload, len, uuid);
+    if (len >= 18 && rng.below(2)) {
+      adField(payload, 0, 0x06 + rng.below(2), uuid, 16);
+      planted++;
+      TEST_ASSERT_TRUE(advertisesService(payload, len, uuid));
+    }
+    delete[] payload;
+  }
+  TEST_ASSERT_GREATER_THAN_UINT32(0, planted);
+}
+
+static void test_fields(void) {
+  uint8_t uuid[16], other[16];
+  parseUuid128(SERVICE, uuid);
+  memcpy(other, uuid, 16);
+  other[7] ^= 0x01;
+  static const uint8_t flags[] = { 0x06 };
+  uint8_t p[62];
+  // second UUID in a list field
+  uint8_t two[32];
+  memcpy(two, other, 16);
+  memcpy(two + 16, uuid, 16);
+  uint8_t len = adField(p, 0, 0x01, flags, 1);
+  len = adField(p, len, 0x07, two, 32);
+  TEST_ASSERT_TRUE(advertisesService(p, len, uuid));
+  // only the near miss, or the UUID in a field of another type
+  len = adField(p, 0, 0x07, other, 16);
+  TEST_ASSERT_FALSE(advertisesService(p, len, uuid));
+  len = adField(p, 0, 0xFF, uuid, 16);
+  TEST_ASSERT_FALSE(advertisesService(p, len, uuid));
+  // a zero-length field ends the search
+  len = adField(p, 0, 0x01, flags, 1);
+  p[len++] = 0;
+  len = adField(p, len, 0x07, uuid, 16);
+  TEST_ASSERT_FALSE(advertisesService(p, len, uuid));
+  // the field running past the payload
+  len = adField(p, 0, 0x07, uuid, 16);
+  TEST_ASSERT_FALSE(advertisesService(p, len - 1, uuid));
+}
+
+struct Setting {
+  BleScanConfig cfg;
+  bool stopAtMatch, filterDuplicates;
+  uint32_t durationMs;
+};
+
+struct ScanStats {
+  uint32_t found, missed, falseHits, worstMs;
+  double avgMs, parsedPerScan;
+};
+
+static ScanStats scan(const Setting &s) {
+  uint8_t uuid[16];
+  parseUuid128(SERVICE, uuid);
+  ScanStats st = {};
+  uint64_t totalMs = 0, parsed = 0;
+  shocknoise::XorShift32 rng(777);
+  for (uint32_t run = 0; run < 200; run++) {
+    SimAdvertiser devs[40];
+    const uint8_t inRsp = rng.below(4) == 0; // a quarter of controllers keep the UUID in the scan response
+    for (uint8_t i = 0; i < 40; i++) makeAdvertiser(devs[i], i == 0 ? inRsp : 2 + rng.below(8), uuid, rng);
+    for (uint8_t i = 0; i < 40; i++) devs[i].next = rng.next() % devs[i].intervalMs;
+    const ScanRun r = simulateScan(devs, 40, s.cfg, s.durationMs, s.stopAtMatch, s.filterDuplicates, uuid, rng);
+    parsed += r.parsed;
+    st.falseHits += r.falseHits;
+    if (!s.cfg.active && inRsp) continue; // passive scans can't find these
+    if (r.foundMs) {
+      st.found++;
+      totalMs += r.foundMs;
+      if (r.foundMs > st.worstMs) st.worstMs = r.foundMs;
+    } else {
+      st.missed++;
+    }
+  }
+  st.avgMs = st.found ? (double)totalMs / st.found : 0.0;
+  st.parsedPerScan = parsed / 200.0;
+  return st;
+}
+
+static void reportScan(const char *name, const ScanStats &st) {
+  bench::report("%s: found %u, missed %u, avg %.0f ms, max %u ms, %.1f payloads parsed", name, st.found, st.missed,
+                st.avgMs, st.worstMs, st.parsedPerScan);
+}
+
+// BLE_SCAN_FAST stopping at the first match finds the controller every time,
+// in well under a second, where the old scan always took its full 10 s
+static void test_fast_scan_finds_controller(void) {
+  const ScanStats fast = scan({ BLE_SCAN_FAST, true, true, BleLink::SCAN_MS });
+  const ScanStats old = scan({ { 100, 100, true }, false, false, 10000 });
+  TEST_ASSERT_EQUAL_UINT32(0, fast.falseHits);
+  TEST_ASSERT_EQUAL_UINT32(0, fast.missed);
+  TEST_ASSERT_TRUE(fast.avgMs < 1000);
+  TEST_ASSERT_EQUAL_UINT32(0, old.falseHits);
+  TEST_ASSERT_TRUE(fast.avgMs < old.avgMs);
+  TEST_ASSERT_TRUE(fast.parsedPerScan < old.parsedPerScan);
+  reportScan("fast 60/60 ms, stop at match", fast);
+  reportScan("old: collect 10 s, then filter", old);
+}
+
+// Slower duty cycles and passive scanning are slower, never wrong
+static void test_other_settings_never_pick_a_decoy(void) {
+  const struct {
+    const char *name;
+    Setting s;
+  } settings[] = {
+    { "balanced 100/50 ms, stop at match", { { 100, 50, true }, true, true, BleLink::SCAN_MS } },
+    { "low duty 1280/11 ms, stop at match", { { 1280, 11, true }, true, true, BleLink::SCAN_MS } },
+    { "fast, passive", { { 60, 60, false }, true, true, BleLink::SCAN_MS } },
+  };
+  for (const auto &setting : settings) {
+    const ScanStats st = scan(setting.s);
+    TEST_ASSERT_EQUAL_UINT32(0, st.falseHits);
+    TEST_ASSERT_GREATER_THAN_UINT32(0, st.found);
+    reportScan(setting.name, st);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_parse_uuid);
+  RUN_TEST(test_fuzz_payloads);
+  RUN_TEST(test_fields);
+  RUN_TEST(test_fast_scan_finds_controller);
+  RUN_TEST(test_other_settings_never_pick_a_decoy);
+  return UNITY_END();
+}
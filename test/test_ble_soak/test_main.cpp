@@ -0,0 +1,140 @@
+// Remote attributes over thousands of reconnects. The simulated soak runs
+// BleLink against the fake stack, whose release() and pretend worker decide
+// who frees through the same BleSetupGate as NimBleStack; the race test runs
+// that gate between two real threads, as loop() and the setup worker.
+#include <malloc.h>
+#include <atomic>
+#include <thread>
+#include <unity.h>
+#include <ble_link.h>
+#include <ble_setup_gate.h>
+#include <shock_noise.h>
+#include "../bench.h"
+#include "../fake_ble_stack.h"
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Thousands of reconnects on a flaky link: up 1-8 s once subscribed, down
+// 0.1-2.6 s, with one setup in 8 hanging past the link's timeout so release()
+// lands while discovery is still running. Remote attributes must be freed
+// after every connection (never more than one set alive, none once the link
+// is down for good) and the process heap must end where it was after the
+// first few, once the allocator has cached its free blocks.
+static void test_soak_frees_every_connection(void) {
+  const uint32_t cycles = 5000;
+  BleLink link;
+  FakeBleStack stack(link);
+  stack.hangEvery = 8;
+  shocknoise::XorShift32 rng(2024);
+  size_t heapBefore = 0;
+  link.begin(&stack, 0);
+  uint32_t now = 0, flipAt = 0;
+  bool wasSubscribed = false;
+  while (link.connects() < cycles) {
+    now += 5;
+    if (link.subscribed() && !wasSubscribed) flipAt = now + 1000 + 28 * rng.below(250);
+    wasSubscribed = link.subscribed();
+    if (flipAt && now >= flipAt) {
+      stack.peerUp = !stack.peerUp;
+      flipAt = stack.peerUp ? 0 : now + 100 + 10 * rng.below(250);
+    }
+    stack.run(now);
+    link.tick(now);
+    TEST_ASSERT_TRUE(!link.subscribed() || stack.session().get());
+    if (!heapBefore && link.connects() >= 10 && !stack.liveAttributes) heapBefore = mallinfo2().uordblks;
+  }
+  // let the last connection drop and any hung setup finish
+  stack.peerUp = false;
+  for (uint32_t end = now + 10000; now < end; now += 5) {
+    stack.run(now);
+    link.tick(now);
+  }
+  const long heapDelta = (long)mallinfo2().uordblks - (long)heapBefore;
+  TEST_ASSERT_EQUAL_INT32(0, stack.liveAttributes);
+  TEST_ASSERT_EQUAL_INT32(1, stack.maxLiveAttributes);
+  TEST_ASSERT_EQUAL_UINT32(stack.connections, stack.releases);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, stack.deferredReleases);
+  TEST_ASSERT_EQUAL_INT32(0, heapDelta);
+  TEST_ASSERT_EQUAL_UINT32(0, stack.misuse);
+  TEST_ASSERT_NULL(stack.session().get());
+  bench::report("%u reconnects (%u connections, %u releases during setup) over %.1f h", link.connects(),
+                stack.connections, stack.deferredReleases, now / 3600000.0);
+}
+
+static void test_gate_states(void) {
+  BleSetupGate gate;
+  TEST_ASSERT_TRUE(gate.release()); // nothing running: free at once
+  TEST_ASSERT_TRUE(gate.beginSetup());
+  TEST_ASSERT_FALSE(gate.beginSetup());
+  TEST_ASSERT_FALSE(gate.endSetup()); // not released meanwhile: the link keeps them
+  TEST_ASSERT_FALSE(gate.busy());
+  TEST_ASSERT_TRUE(gate.beginSetup());
+  TEST_ASSERT_FALSE(gate.release()); // left to the worker...
+  TEST_ASSERT_FALSE(gate.release()); // ...however often asked
+  TEST_ASSERT_FALSE(gate.beginSetup());
+  TEST_ASSERT_TRUE(gate.endSetup()); // which frees them
+  TEST_ASSERT_TRUE(gate.beginSetup());
+}
+
+// loop() starts setup on each new link and releases it after a random time,
+// the worker discovers for a random time and finishes: whichever lands first,
+// every attribute set is freed exactly once and never while the worker still
+// writes to it (run with -fsanitize=thread or address to catch the latter)
+struct RaceAttributes {
+  uint32_t table[64];
+};
+
+static void test_gate_race(void) {
+  const uint32_t links = 20000;
+  BleSetupGate gate;
+  std::atomic<RaceAttributes *> job{nullptr};
+  std::atomic<bool> stop{false};
+  std::atomic<uint32_t> freedByWorker{0};
+  std::thread worker([&] {
+    shocknoise::XorShift32 rng(5);
+    while (!stop) {
+      RaceAttributes *a = job.exchange(nullptr);
+      if (!a) {
+        std::this_thread::yield();
+        continue;
+      }
+      for (uint32_t spin = rng.below(200); spin--;) a->table[spin % 64] += spin;
+      if (gate.endSetup()) {
+        delete a;
+        freedByWorker++;
+      }
+    }
+  });
+  shocknoise::XorShift32 rng(6);
+  uint32_t freedByLink = 0, refused = 0;
+  for (uint32_t i = 0; i < links; i++) {
+    while (!gate.beginSetup()) {
+      refused++;
+      std::this_thread::yield();
+    }
+    RaceAttributes *a = new RaceAttributes();
+    job = a;
+    for (uint32_t n = rng.below(64); n--;) std::this_thread::yield();
+    if (gate.release()) {
+      delete a;
+      freedByLink++;
+    }
+  }
+  while (gate.busy()) std::this_thread::yield();
+  stop = true;
+  worker.join();
+  TEST_ASSERT_EQUAL_UINT32(links, freedByLink + freedByWorker);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, freedByLink);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, freedByWorker);
+  bench::report("%u links, %u freed by release(), %u by the worker, %u setups refused while busy", links, freedByLink,
+                freedByWorker.load(), refused);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_soak_frees_every_connection);
+  RUN_TEST(test_gate_states);
+  RUN_TEST(test_gate_race);
+  return UNITY_END();
+}
@@ -0,0 +1,182 @@
+// DisplayScheduler on a fake bus: the host TFT_eSPI with a BusMonitor that
+// reads the chip-select lines at every bus call, so a transfer to the wrong
+// panel, or CS moving under a transaction, is caught where it happens.
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unity.h>
+#include <Arduino.h>
+#include <TFT_eSPI.h>
+#include <display_scheduler.h>
+#include <palette.h>
+#include <round_mask.h>
+
+static const uint8_t CS_0 = 10, CS_1 = 2; // as on the board
+
+struct Transaction {
+  uint8_t panel;
+  uint32_t pixels;
+};
+
+// Panel selected by the CS lines, -1 for none or both
+typedef int8_t (*SelectedFn)();
+
+struct FakeBus : BusMonitor {
+  TFT_eSPI *tft;
+  SelectedFn selected;
+  std::mutex m;
+  std::vector<Transaction> transactions;
+  uint32_t violations = 0;
+  int8_t cs = -1; // as at START_WRITE
+  bool open = false;
+
+  FakeBus(TFT_eSPI *t, SelectedFn fn) : tft(t), selected(fn) {}
+
+  void onBus(BusOp op, uint8_t, uint32_t count) override {
+    std::lock_guard<std::mutex> lock(m);
+    if (op == BUS_START_WRITE) {
+      cs = selected();
+      if (open || cs < 0) violations++;
+      open = true;
+      if (cs >= 0) tft->selectPanel(cs); // pixels go where CS points
+      transactions.push_back({ (uint8_t)(cs < 0 ? 0 : cs), 0 });
+      return;
+    }
+    if (!open || selected() != cs) violations++; // outside a transaction, or CS moved
+    if (op == BUS_PIXELS_DMA || op == BUS_PIXELS) transactions.back().pixels += count;
+    if (op == BUS_END_WRITE) open = false;
+  }
+
+  std::vector<Transaction> take() {
+    std::lock_guard<std::mutex> lock(m);
+    std::vector<Transaction> out;
+    out.swap(transactions);
+    return out;
+  }
+};
+
+// Panel 0 animated at 30 Hz in RGB332, panel 1 static at 10 Hz in 4-bit, as in setup()
+static uint32_t renders[2];
+
+static void render0(TFT_eSprite &spr, DirtyTracker &dirty) {
+  spr.fillSprite(spr.color8to16((renders[0]++ * 29) & 0xFF));
+  dirty.markAll();
+}
+
+static void render1(TFT_eSprite &spr, DirtyTracker &dirty) {
+  spr.fillSprite(renders[1]++ & 15);
+  dirty.markAll();
+}
+
+// Default path: CS through digitalWrite on the panels' pins
+static TFT_eSPI tft;
+static int8_t pinsSelected() {
+  const bool a = digitalRead(CS_0) == LOW, b = digitalRead(CS_1) == LOW;
+  return a == b ? -1 : (a ? 0 : 1);
+}
+static FakeBus bus(&tft, pinsSelected);
+static DisplayScheduler displays(&tft);
+
+// setChipSelect() path, recording every call
+static TFT_eSPI tftFast;
+static std::vector<int8_t> csCalls;
+static int8_t fastSelected = -1;
+static void recordSelect(int8_t panel) {
+  csCalls.push_back(panel);
+  fastSelected = panel;
+  if (panel >= 0) tftFast.selectPanel(panel);
+}
+static int8_t recordedSelected() { return fastSelected; }
+static FakeBus busFast(&tftFast, recordedSelected);
+static DisplayScheduler displaysFast(&tftFast);
+
+static void runFor(DisplayScheduler &d, uint32_t ms) {
+  const uint32_t start = millis();
+  while (millis() - start < ms) {
+    d.tick();
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  d.waitIdle();
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_begin_deselects_panels(void) {
+  TEST_ASSERT_EQUAL_INT8(0, displays.addPanel(CS_0, 0, 30, true, render0));
+  TEST_ASSERT_EQUAL_INT8(1, displays.addPanel(CS_1, 0, 10, false, render1, palette::screen1Palette));
+  TEST_ASSERT_TRUE(displays.begin());
+  TEST_ASSERT_EQUAL(HIGH, digitalRead(CS_0));
+  TEST_ASSERT_EQUAL(HIGH, digitalRead(CS_1));
+  tft.setBusMonitor(&bus);
+  TEST_ASSERT_TRUE(displays.start());
+}
+
+// Each panel's dirty windows are sized from the panel: the first frames send
+// the visible circle of the 240x240 panel, not more and not less
+static void test_first_frames_are_the_visible_circle(void) {
+  while (displays.tick() != 1) {}
+  displays.waitIdle();
+  std::vector<Transaction> t = bus.take();
+  TEST_ASSERT_EQUAL(2, t.size());
+  for (uint8_t i = 0; i < 2; i++) {
+    TEST_ASSERT_EQUAL_UINT8(i, t[i].panel);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(roundMask.visiblePixels(), t[i].pixels);
+    TEST_ASSERT_LESS_THAN_UINT32(240 * 240 * 85 / 100, t[i].pixels);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, bus.violations);
+}
+
+// Earliest deadline first: the animated panel gets its 30 Hz, the static one
+// nothing until invalidated, then one frame. Every transfer has exactly its
+// panel's CS low from startWrite to endWrite, and lands on that panel.
+static void test_schedule_and_chip_selects(void) {
+  const uint32_t before0 = renders[0], before1 = renders[1];
+  runFor(displays, 1100);
+  TEST_ASSERT_UINT32_WITHIN(3, 33, renders[0] - before0);
+  TEST_ASSERT_EQUAL_UINT32(before1, renders[1]);
+  TEST_ASSERT_FLOAT_WITHIN(3, 30, displays.achievedFps(0));
+
+  displays.invalidate(1);
+  runFor(displays, 150);
+  TEST_ASSERT_EQUAL_UINT32(before1 + 1, renders[1]);
+
+  std::vector<Transaction> t = bus.take();
+  uint32_t per[2] = {};
+  for (const Transaction &x : t) per[x.panel]++;
+  TEST_ASSERT_EQUAL_UINT32(renders[0] - before0, per[0]);
+  TEST_ASSERT_EQUAL_UINT32(renders[1] - before1, per[1]);
+  TEST_ASSERT_EQUAL_UINT32(0, bus.violations);
+
+  // the last frame of each panel is on that panel, in its own colour
+  TEST_ASSERT_EQUAL_HEX16(tft.color8to16(((renders[0] - 1) * 29) & 0xFF), tft.panelPixels(0)[120 * 240 + 120]);
+  TEST_ASSERT_EQUAL_HEX16(palette::screen1Palette[(renders[1] - 1) & 15], tft.panelPixels(1)[120 * 240 + 120]);
+}
+
+// With setChipSelect() the scheduler never touches the pins itself past begin()
+static void test_custom_chip_select(void) {
+  displaysFast.addPanel(20, 0, 30, true, render0);
+  displaysFast.addPanel(21, 0, 10, false, render1, palette::screen1Palette);
+  displaysFast.setChipSelect(recordSelect);
+  TEST_ASSERT_TRUE(displaysFast.begin());
+  // init each panel, then rotate and clear each, then release the bus
+  const int8_t expected[] = { 0, 1, 0, 1, -1 };
+  TEST_ASSERT_EQUAL(sizeof(expected), csCalls.size());
+  TEST_ASSERT_EQUAL_INT8_ARRAY(expected, csCalls.data(), sizeof(expected));
+
+  tftFast.setBusMonitor(&busFast);
+  TEST_ASSERT_TRUE(displaysFast.start());
+  runFor(displaysFast, 200);
+  std::vector<Transaction> t = busFast.take();
+  TEST_ASSERT_GREATER_OR_EQUAL(6, t.size());
+  TEST_ASSERT_EQUAL_UINT32(0, busFast.violations);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_begin_deselects_panels);
+  RUN_TEST(test_first_frames_are_the_visible_circle);
+  RUN_TEST(test_schedule_and_chip_selects);
+  RUN_TEST(test_custom_chip_select);
+  return UNITY_END();
+}
@@ -0,0 +1,78 @@
+// FastChipSelect against the host GPIO registers: the same pin levels as the
+// digitalWrite path DisplayScheduler falls back to, and what each costs.
+#include <unity.h>
+#include <Arduino.h>
+#include <fast_cs.h>
+#include "../bench.h"
+
+static const uint8_t CS_0 = 10, CS_1 = 2; // as on the board
+typedef FastChipSelect<CS_0, CS_1> Cs;
+
+// DisplayScheduler::select() without setChipSelect()
+static void slowSelect(int8_t panel) {
+  const uint8_t pins[] = { CS_0, CS_1 };
+  for (uint8_t i = 0; i < 2; i++) digitalWrite(pins[i], i == panel ? LOW : HIGH);
+}
+
+void setUp(void) { GPIO.out = 0; }
+void tearDown(void) {}
+
+static void test_masks(void) {
+  TEST_ASSERT_EQUAL_HEX32(1UL << CS_0 | 1UL << CS_1, Cs::allMask());
+  TEST_ASSERT_EQUAL_HEX32(1UL << CS_0, Cs::panelMask(0));
+  TEST_ASSERT_EQUAL_HEX32(1UL << CS_1, Cs::panelMask(1));
+}
+
+// Exactly the selected panel's CS is low; -1 or an unknown panel deselects both
+static void test_select(void) {
+  const int8_t panels[] = { 0, 1, 1, 0, -1, 1, 2, 0 };
+  for (int8_t p : panels) {
+    Cs::select(p);
+    TEST_ASSERT_EQUAL(p == 0 ? LOW : HIGH, digitalRead(CS_0));
+    TEST_ASSERT_EQUAL(p == 1 ? LOW : HIGH, digitalRead(CS_1));
+  }
+}
+
+// Other pins of the bank keep their level
+static void test_leaves_other_pins(void) {
+  const uint32_t others = 0xA5A5A5A5 & ~Cs::allMask();
+  GPIO.out = others;
+  Cs::select(1);
+  Cs::select(0);
+  TEST_ASSERT_EQUAL_HEX32(others, GPIO.out & ~Cs::allMask());
+  Cs::select(-1);
+  TEST_ASSERT_EQUAL_HEX32(others | Cs::allMask(), GPIO.out);
+}
+
+// Same levels as the digitalWrite path for every switch
+static void test_matches_digital_write(void) {
+  for (int8_t p = -1; p < 2; p++) {
+    slowSelect(p);
+    const uint32_t slow = GPIO.out;
+    GPIO.out = 0;
+    Cs::select(p);
+    TEST_ASSERT_EQUAL_HEX32(slow, GPIO.out);
+  }
+}
+
+// A panel switch, as made around every frame transfer. On the host digitalWrite
+// is a plain function call; on the S3 it also goes through the pin matrix
+// lookups of the Arduino core, which the register stores skip.
+static void test_benchmark(void) {
+  const int reps = 2000000;
+  int8_t p = 0;
+  const double slow = bench::microsPer(reps, [&] { slowSelect(p ^= 1); });
+  const double fast = bench::microsPer(reps, [&] { Cs::select(p ^= 1); });
+  bench::report("panel switch: digitalWrite %.1f ns, FastChipSelect %.1f ns", slow * 1000, fast * 1000);
+  TEST_ASSERT_TRUE(fast < slow);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_masks);
+  RUN_TEST(test_select);
+  RUN_TEST(test_leaves_other_pins);
+  RUN_TEST(test_matches_digital_write);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
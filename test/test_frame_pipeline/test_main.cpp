@@ -0,0 +1,231 @@
+// FramePipeline against a mock SPI transport: the host TFT_eSPI bus, watched by
+// a BusMonitor that checks the order of chip selects, windows and DMA transfers
+// and can make each DMA chunk take time, like the real bus at 80 MHz.
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unity.h>
+#include <TFT_eSPI.h>
+#include <frame_pipeline.h>
+#include <palette.h>
+#include "../bench.h"
+
+static TFT_eSPI bus;
+
+// Transport state as the pipeline's task sees it; every rule broken is counted
+struct MockTransport : BusMonitor {
+  std::atomic<uint32_t> violations{0};
+  std::atomic<uint32_t> chunkDelayUs{0};
+  bool inTransaction = false;
+  bool dmaInFlight = false;
+  uint32_t windowPixels = 0, sentPixels = 0;
+  bool uniformFrames = false; // every frame is one colour: check no frame mixes two buffers
+  std::mutex m;
+  std::vector<uint8_t> selects; // panels in the order they were selected
+
+  void reset() {
+    std::lock_guard<std::mutex> lock(m);
+    violations = 0;
+    chunkDelayUs = 0;
+    inTransaction = dmaInFlight = uniformFrames = false;
+    windowPixels = sentPixels = 0;
+    selects.clear();
+  }
+
+  void select(uint8_t panel) {
+    std::lock_guard<std::mutex> lock(m);
+    if (inTransaction || dmaInFlight) violations++; // CS switched under a transfer
+    selects.push_back(panel);
+    bus.selectPanel(panel);
+  }
+
+  void onBus(BusOp op, uint8_t panel, uint32_t count) override {
+    switch (op) {
+    case BUS_START_WRITE:
+      if (inTransaction) violations++;
+      inTransaction = true;
+      break;
+    case BUS_ADDR_WINDOW:
+      // commands must not overtake pixels still in flight, and every window is filled
+      if (!inTransaction || dmaInFlight || sentPixels != windowPixels) violations++;
+      windowPixels = count;
+      sentPixels = 0;
+      break;
+    case BUS_PIXELS_DMA:
+      // the real call waits for the previous chunk, then starts this one
+      if (!inTransaction) violations++;
+      if (chunkDelayUs) std::this_thread::sleep_for(std::chrono::microseconds(chunkDelayUs.load()));
+      dmaInFlight = true;
+      sentPixels += count;
+      break;
+    case BUS_DMA_WAIT:
+      dmaInFlight = false;
+      break;
+    case BUS_PIXELS:
+      violations++; // synchronous pushes never happen once the pipeline runs
+      break;
+    case BUS_END_WRITE:
+      if (!inTransaction || dmaInFlight || sentPixels != windowPixels) violations++;
+      inTransaction = false;
+      if (uniformFrames) {
+        const uint16_t *px = bus.panelPixels(panel);
+        for (int i = 1; i < bus.width() * bus.height(); i++) {
+          if (px[i] != px[0]) {
+            violations++;
+            break;
+          }
+        }
+      }
+      break;
+    }
+  }
+};
+
+static MockTransport transport;
+static void selectThunk(void *, uint8_t screen) { transport.select(screen); }
+
+// Screen 0 is 8-bit like the compass screen, screen 1 4-bit like the map
+static FramePipeline pipeline(&bus, selectThunk, nullptr);
+static TFT_eSprite frames[4] = { TFT_eSprite(&bus), TFT_eSprite(&bus), TFT_eSprite(&bus), TFT_eSprite(&bus) };
+
+static void pattern(TFT_eSprite &spr, uint32_t frame) {
+  for (int y = 0; y < spr.height(); y++) {
+    for (int x = 0; x < spr.width(); x++) {
+      spr.drawPixel(x, y, spr.getColorDepth() == 4 ? (x + y + frame) & 15 : spr.color8to16((x * 3 + y * 5 + frame) & 0xFF));
+    }
+  }
+}
+
+static uint16_t expected(uint8_t screen, int x, int y, uint32_t frame) {
+  if (screen == 1) return palette::screen1Palette[(x + y + frame) & 15];
+  return bus.color8to16((x * 3 + y * 5 + frame) & 0xFF);
+}
+
+static DirtyRegion fullFrame() {
+  DirtyRegion r(bus.width(), bus.height());
+  r.addAll();
+  return r;
+}
+
+void setUp(void) { transport.reset(); }
+void tearDown(void) {}
+
+// Before begin() submit pushes at once, selecting the panel first
+static void test_synchronous_fallback(void) {
+  for (uint8_t s = 0; s < 2; s++) {
+    pattern(pipeline.acquire(s), 7);
+    pipeline.submit(s, fullFrame());
+    const uint16_t *px = bus.panelPixels(s);
+    for (int i = 0; i < bus.width() * bus.height(); i++) {
+      TEST_ASSERT_EQUAL_HEX16(expected(s, i % bus.width(), i / bus.width(), 7), px[i]);
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(2, transport.selects.size());
+}
+
+static void test_starts(void) {
+  bus.setBusMonitor(&transport);
+  TEST_ASSERT_TRUE(pipeline.begin());
+}
+
+// Every frame reaches its panel with the right pixels, for both colour depths
+static void test_frames_reach_panels(void) {
+  transport.chunkDelayUs = 20;
+  for (uint32_t f = 0; f < 6; f++) {
+    for (uint8_t s = 0; s < 2; s++) {
+      pattern(pipeline.acquire(s), f * 2 + s);
+      pipeline.submit(s, fullFrame());
+    }
+  }
+  pipeline.waitIdle();
+  for (uint8_t s = 0; s < 2; s++) {
+    const uint16_t *px = bus.panelPixels(s);
+    for (int i = 0; i < bus.width() * bus.height(); i++) {
+      TEST_ASSERT_EQUAL_HEX16(expected(s, i % bus.width(), i / bus.width(), 10 + s), px[i]);
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, transport.violations.load());
+}
+
+// Random dirty windows on both screens: panels are selected in submit order,
+// never under a transaction or DMA, and every window gets exactly its pixels
+static void test_bus_order(void) {
+  transport.chunkDelayUs = 5;
+  std::vector<uint8_t> submitted;
+  uint32_t seed = 1;
+  for (int f = 0; f < 200; f++) {
+    const uint8_t s = (seed >> 7) & 1;
+    TFT_eSprite &spr = pipeline.acquire(s);
+    spr.fillRect(0, 0, 8, 8, f & 15);
+    DirtyRegion region(bus.width(), bus.height(), true);
+    for (int n = 0; n < 3; n++) {
+      seed = seed * 1103515245 + 12345;
+      region.add((seed >> 8) % 200, (seed >> 16) % 200, 1 + (seed >> 4) % 40, 1 + (seed >> 12) % 40);
+    }
+    pipeline.submit(s, region);
+    submitted.push_back(s);
+  }
+  pipeline.waitIdle();
+  std::lock_guard<std::mutex> lock(transport.m);
+  TEST_ASSERT_EQUAL_UINT32(submitted.size(), transport.selects.size());
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(submitted.data(), transport.selects.data(), submitted.size());
+  TEST_ASSERT_EQUAL_UINT32(0, transport.violations.load());
+}
+
+// A buffer being sent is never drawn into: with slow transfers and a render
+// loop that repaints every frame in one new colour, no panel frame mixes two
+static void test_no_tearing(void) {
+  transport.uniformFrames = true;
+  transport.chunkDelayUs = 30;
+  for (uint32_t f = 0; f < 40; f++) {
+    TFT_eSprite &spr = pipeline.acquire(0);
+    spr.fillSprite(spr.color8to16(f * 37 & 0xFF));
+    pipeline.submit(0, fullFrame());
+  }
+  pipeline.waitIdle();
+  TEST_ASSERT_EQUAL_UINT32(0, transport.violations.load());
+}
+
+// Rendering frame N+1 overlaps sending frame N: with render and transfer both
+// about 2 ms, a run takes close to the longer of the two per frame, not the sum
+static void test_render_overlaps_transfer(void) {
+  const int frames = 30;
+  const uint32_t renderUs = 2000;
+  transport.chunkDelayUs = 35; // 57 chunks per full 8-bit frame
+  pipeline.takeBusyMicros();
+  const auto start = std::chrono::steady_clock::now();
+  for (int f = 0; f < frames; f++) {
+    pipeline.acquire(0);
+    std::this_thread::sleep_for(std::chrono::microseconds(renderUs)); // "rendering"
+    pipeline.submit(0, fullFrame());
+  }
+  pipeline.waitIdle();
+  const double elapsedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  const double busUs = pipeline.takeBusyMicros();
+  const double serialUs = frames * (double)renderUs + busUs;
+  bench::report("%d frames: %.1f ms pipelined, %.1f ms render + %.1f ms transfer back to back", frames,
+                elapsedUs / 1000, frames * renderUs / 1000.0, busUs / 1000);
+  TEST_ASSERT_LESS_THAN(serialUs * 0.8, elapsedUs);
+  TEST_ASSERT_EQUAL_UINT32(0, transport.violations.load());
+}
+
+int main() {
+  bus.init();
+  for (int i = 0; i < 4; i++) {
+    frames[i].setColorDepth(i < 2 ? 8 : 4);
+    frames[i].createSprite(bus.width(), bus.height());
+    if (i >= 2) frames[i].createPalette(palette::screen1Palette, 16);
+  }
+  pipeline.addScreen(0, &frames[0], &frames[1]);
+  pipeline.addScreen(1, &frames[2], &frames[3]);
+  UNITY_BEGIN();
+  RUN_TEST(test_synchronous_fallback);
+  RUN_TEST(test_starts);
+  RUN_TEST(test_frames_reach_panels);
+  RUN_TEST(test_bus_order);
+  RUN_TEST(test_no_tearing);
+  RUN_TEST(test_render_overlaps_transfer);
+  return UNITY_END();
+}
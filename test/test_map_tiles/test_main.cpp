@@ -0,0 +1,172 @@
+// Every tile of every map level decoded and compared with the source bitmap
+// the generator read, tools/map_source.h, plus the LZ4 decoder's guards. The
+// reduced levels are checked the same way whether stored or derived.
+#include <vector>
+#include <unity.h>
+#include <Arduino.h>
+#include <map_tiles.h>
+#include "../../tools/map_source.h"
+#include "../bench.h"
+
+using namespace maptiles;
+
+static const uint8_t *const source = epd_bitmap_map__2_;
+static const uint32_t SOURCE_STRIDE = (MAP_WIDTH + 7) / 8;
+
+static int sourcePixel(int32_t x, int32_t y) { return (source[y * SOURCE_STRIDE + (x >> 3)] >> (7 - (x & 7))) & 1; }
+
+// Pixel (x, y) of level n as tools/map_tiles.py defines it: the set pixels of
+// its 2^n box, clipped to the map, quantised to 2 bits rounding down
+static std::vector<uint8_t> referenceLevel(uint8_t n) {
+  const MapLevel &l = mapLevels[n];
+  const int32_t scale = 1 << n;
+  std::vector<uint8_t> out((size_t)l.width * l.height);
+  for (int32_t y = 0; y < l.height; y++) {
+    for (int32_t x = 0; x < l.width; x++) {
+      uint32_t count = 0;
+      for (int32_t sy = y * scale; sy < (y + 1) * scale && sy < MAP_HEIGHT; sy++) {
+        for (int32_t sx = x * scale; sx < (x + 1) * scale && sx < MAP_WIDTH; sx++) count += sourcePixel(sx, sy);
+      }
+      out[(size_t)y * l.width + x] = (uint8_t)(3 * count / (scale * scale));
+    }
+  }
+  return out;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Level 0 tiles are byte for byte the source rows, zero past its edges
+static void test_level0_matches_source(void) {
+  const MapLevel &l = mapLevels[0];
+  uint8_t tile[MAX_TILE_BYTES];
+  const uint16_t rb = rowBytes(l);
+  for (uint16_t ty = 0; ty < l.tilesY; ty++) {
+    for (uint16_t tx = 0; tx < l.tilesX; tx++) {
+      TEST_ASSERT_TRUE(decodeTile(0, tx, ty, tile));
+      for (uint16_t row = 0; row < MAP_TILE_SIZE; row++) {
+        const uint32_t y = ty * MAP_TILE_SIZE + row;
+        for (uint16_t b = 0; b < rb; b++) {
+          const uint32_t sb = tx * rb + b;
+          const uint8_t expected = y < MAP_HEIGHT && sb < SOURCE_STRIDE ? source[y * SOURCE_STRIDE + sb] : 0;
+          if (tile[row * rb + b] != expected) {
+            char msg[64];
+            snprintf(msg, sizeof(msg), "tile %u,%u row %u byte %u", tx, ty, row, b);
+            TEST_FAIL_MESSAGE(msg);
+          }
+        }
+      }
+    }
+  }
+}
+
+// Reduced levels hold the quantised box coverage of the source, zero past their edges
+static void test_reduced_levels_match_source(void) {
+  uint8_t tile[MAX_TILE_BYTES];
+  for (uint8_t n = 1; n < MAP_LEVELS; n++) {
+    const MapLevel &l = mapLevels[n];
+    TEST_ASSERT_EQUAL_UINT16((MAP_WIDTH + (1 << n) - 1) >> n, l.width);
+    TEST_ASSERT_EQUAL_UINT16((MAP_HEIGHT + (1 << n) - 1) >> n, l.height);
+    const std::vector<uint8_t> ref = referenceLevel(n);
+    const uint8_t perByte = 8 / l.bpp, mask = (1 << l.bpp) - 1;
+    const uint16_t rb = rowBytes(l);
+    for (uint16_t ty = 0; ty < l.tilesY; ty++) {
+      for (uint16_t tx = 0; tx < l.tilesX; tx++) {
+        TEST_ASSERT_TRUE(decodeTile(n, tx, ty, tile));
+        for (int32_t py = 0; py < MAP_TILE_SIZE; py++) {
+          for (int32_t px = 0; px < MAP_TILE_SIZE; px++) {
+            const int32_t x = tx * MAP_TILE_SIZE + px, y = ty * MAP_TILE_SIZE + py;
+            const uint8_t got = (tile[py * rb + px / perByte] >> (8 - l.bpp * (px % perByte + 1))) & mask;
+            const uint8_t expected = x < l.width && y < l.height ? ref[(size_t)y * l.width + x] : 0;
+            if (got != expected) {
+              char msg[80];
+              snprintf(msg, sizeof(msg), "level %u pixel %d,%d: %u, expected %u", n, (int)x, (int)y, got, expected);
+              TEST_FAIL_MESSAGE(msg);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+static void test_tiles_outside_the_map(void) {
+  uint8_t tile[MAX_TILE_BYTES];
+  for (uint8_t n = 0; n < MAP_LEVELS; n++) {
+    TEST_ASSERT_FALSE(decodeTile(n, mapLevels[n].tilesX, 0, tile));
+    TEST_ASSERT_FALSE(decodeTile(n, 0, mapLevels[n].tilesY, tile));
+    TEST_ASSERT_FALSE(tileInMap(n, -1, 0));
+  }
+  TEST_ASSERT_FALSE(decodeTile(MAP_LEVELS, 0, 0, tile));
+}
+
+// Hits return the cached tile, evictions decode again, outside is null
+static void test_cache(void) {
+  static TileCache<2> cache;
+  const uint8_t *a = cache.get(0, 3, 4);
+  TEST_ASSERT_NOT_NULL(a);
+  TEST_ASSERT_EQUAL_PTR(a, cache.get(0, 3, 4));
+  const uint8_t *b = cache.get(1, 3, 4);
+  TEST_ASSERT_NOT_NULL(b);
+  TEST_ASSERT_TRUE(a != b);
+  cache.get(0, 3, 4);                          // a is now the most recent
+  TEST_ASSERT_EQUAL_PTR(b, cache.get(2, 0, 0)); // so b's slot goes
+  uint8_t tile[MAX_TILE_BYTES];
+  decodeTile(0, 3, 4, tile);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(tile, cache.get(0, 3, 4), tileBytes(mapLevels[0]));
+  TEST_ASSERT_NULL(cache.get(0, -1, 0));
+}
+
+// Corrupt blocks fail instead of reading or writing out of bounds
+static void test_lz4_rejects_malformed_blocks(void) {
+  const MapLevel &l = mapLevels[0];
+  uint32_t n = 0;
+  while (l.index[n] & MAP_TILE_RAW) n++;
+  const uint8_t *block = l.data + l.index[n];
+  const uint32_t len = (l.index[n + 1] & ~MAP_TILE_RAW) - l.index[n];
+  uint8_t out[MAX_TILE_BYTES + 1];
+  TEST_ASSERT_TRUE(lz4Decode(block, len, out, tileBytes(l)));
+  for (uint32_t cut = 1; cut < len; cut++) TEST_ASSERT_FALSE(lz4Decode(block, len - cut, out, tileBytes(l)));
+  TEST_ASSERT_FALSE(lz4Decode(block, len, out, tileBytes(l) - 1)); // output too small
+  TEST_ASSERT_FALSE(lz4Decode(block, len, out, tileBytes(l) + 1)); // block ends short
+
+  const uint8_t zeroOffset[] = { 0x10, 0xAA, 0x00, 0x00, 0x50, 1, 2, 3, 4, 5 };
+  TEST_ASSERT_FALSE(lz4Decode(zeroOffset, sizeof(zeroOffset), out, 10));
+  const uint8_t pastStart[] = { 0x10, 0xAA, 0x02, 0x00, 0x50, 1, 2, 3, 4, 5 };
+  TEST_ASSERT_FALSE(lz4Decode(pastStart, sizeof(pastStart), out, 10));
+  const uint8_t literalsPastEnd[] = { 0xF0, 0x20, 1, 2 };
+  TEST_ASSERT_FALSE(lz4Decode(literalsPastEnd, sizeof(literalsPastEnd), out, sizeof(out)));
+  const uint8_t ok[] = { 0x10, 0xAA, 0x01, 0x00, 0x50, 1, 2, 3, 4, 5 };
+  TEST_ASSERT_TRUE(lz4Decode(ok, sizeof(ok), out, 10));
+  const uint8_t expected[] = { 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 1, 2, 3, 4, 5 };
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, out, sizeof(expected));
+}
+
+// Level 1 is built from four level-0 tiles on a cache miss instead of being stored
+static void test_decode_benchmark(void) {
+  uint8_t tile[MAX_TILE_BYTES];
+  uint32_t n = 0;
+  const double stored = bench::microsPer(2000, [&] {
+    decodeTile(0, n % mapLevels[0].tilesX, (n / mapLevels[0].tilesX) % mapLevels[0].tilesY, tile);
+    n++;
+  });
+  n = 0;
+  const double derived = bench::microsPer(2000, [&] {
+    decodeTile(1, n % mapLevels[1].tilesX, (n / mapLevels[1].tilesX) % mapLevels[1].tilesY, tile);
+    n++;
+  });
+  bench::keep(tile[0]);
+  bench::report("tile decode: level 0 %.2f us, level 1 derived %.2f us", stored, derived);
+  TEST_ASSERT_NULL(mapLevels[1].index);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_level0_matches_source);
+  RUN_TEST(test_reduced_levels_match_source);
+  RUN_TEST(test_tiles_outside_the_map);
+  RUN_TEST(test_cache);
+  RUN_TEST(test_lz4_rejects_malformed_blocks);
+  RUN_TEST(test_decode_benchmark);
+  return UNITY_END();
+}
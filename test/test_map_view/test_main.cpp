@@ -0,0 +1,223 @@
+// MapRenderer against a per-pixel reference read straight from the decoded
+// tiles, and what a frame costs while the map pans, against drawing it a
+// pixel at a time as screen 1 did before the renderer. Heading-up frames are
+// compared with golden images and with a floating-point rotation.
+#include <math.h>
+#include <vector>
+#include <unity.h>
+#include <Arduino.h>
+#include <map_view.h>
+#include <palette.h>
+#include "../bench.h"
+#include "../golden.h"
+
+static const int16_t SIZE = 240;
+static const uint8_t SENTINEL = 0xEE; // outside the round panel, never written
+
+static maptiles::TileCache<16> tiles;
+static MapRenderer<16> renderer(tiles);
+
+// Value of level pixel (x, y): the bit at level 0, the 2-bit coverage above, 0 off the map
+static uint8_t levelPixel(uint8_t level, int32_t x, int32_t y) {
+  const MapLevel &l = mapLevels[level];
+  if (x < 0 || y < 0 || x >= l.width || y >= l.height) return 0;
+  const uint8_t *tile = tiles.get(level, x / MAP_TILE_SIZE, y / MAP_TILE_SIZE);
+  if (!tile) return 0;
+  const int32_t bit = (x % MAP_TILE_SIZE) * l.bpp;
+  const uint8_t b = tile[(y % MAP_TILE_SIZE) * maptiles::rowBytes(l) + bit / 8];
+  return (b >> (8 - l.bpp - bit % 8)) & ((1 << l.bpp) - 1);
+}
+
+// One byte per pixel: fg 3 / bg 0 draw level values as themselves, since the
+// RGB332 grey steps from 0 to 3 are 0, 1, 2, 3
+static std::vector<uint8_t> render8(const MapView &view) {
+  std::vector<uint8_t> buf(SIZE * SIZE, SENTINEL);
+  SpanTarget t = { buf.data(), SIZE, SIZE, nullptr, 8, SIZE, nullptr };
+  renderer.render(t, view, 3, 0);
+  return buf;
+}
+
+static void checkAgainstReference(const MapView &view) {
+  const std::vector<uint8_t> got = render8(view);
+  const int8_t zoom = view.zoom;
+  const uint8_t level = zoom < 0 ? -zoom : 0, mag = zoom > 0 ? zoom : 0;
+  const int32_t left = (view.centerX >> level) - ((SIZE / 2) >> mag);
+  const int32_t top = (view.centerY >> level) - ((SIZE / 2) >> mag);
+  for (int32_t y = 0; y < SIZE; y++) {
+    int32_t x0, x1;
+    roundSpan(SIZE, SIZE, y, x0, x1);
+    for (int32_t x = 0; x < SIZE; x++) {
+      uint8_t expected = SENTINEL;
+      if (x >= x0 && x <= x1) {
+        expected = levelPixel(level, left + (x >> mag), top + (y >> mag));
+        if (level == 0) expected *= 3;
+      }
+      if (got[y * SIZE + x] != expected) {
+        char msg[100];
+        snprintf(msg, sizeof(msg), "view %d,%d zoom %d: pixel %d,%d is %u, expected %u", (int)view.centerX,
+                 (int)view.centerY, zoom, (int)x, (int)y, got[y * SIZE + x], expected);
+        TEST_FAIL_MESSAGE(msg);
+      }
+    }
+  }
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Every zoom, at byte-aligned and unaligned offsets, and hanging off each edge of the map
+static void test_matches_reference(void) {
+  const int32_t xs[] = { 0, 1, 3, 7, 8, 1000, 1003, MAP_WIDTH - 1, MAP_WIDTH + 50, -60 };
+  const int32_t ys[] = { 0, 5, 968, MAP_HEIGHT - 1, -30 };
+  for (int8_t zoom = MapRenderer<16>::MIN_ZOOM; zoom <= MapRenderer<16>::MAX_ZOOM; zoom++) {
+    for (int32_t x : xs) {
+      for (int32_t y : ys) checkAgainstReference({ x, y, zoom, 0 });
+    }
+  }
+}
+
+// A 4-bit target gets the same pixels as palette indices, packed two to a byte
+static void test_packed_target(void) {
+  for (int8_t zoom = -1; zoom <= 1; zoom++) {
+    const MapView view = { 1234, 567, zoom, 0 };
+    const std::vector<uint8_t> ref = render8(view);
+    std::vector<uint8_t> buf(SIZE * SIZE / 2, 0);
+    SpanTarget t = { buf.data(), SIZE, SIZE, nullptr, 4, SIZE / 2, nullptr };
+    renderer.render(t, view, 15, 0);
+    for (int32_t i = 0; i < SIZE * SIZE; i++) {
+      const uint8_t got = (buf[i / 2] >> (i & 1 ? 0 : 4)) & 15;
+      const uint8_t expected = ref[i] == SENTINEL ? 0 : ref[i] * 5; // grey steps 0, 5, 10, 15
+      if (got != expected) TEST_FAIL_MESSAGE("4-bit pixel differs from the 8-bit one");
+    }
+  }
+}
+
+// The old updateScreen1() path: one cache lookup and drawPixel-style store per pixel
+static void renderPerPixel(std::vector<uint8_t> &buf, const MapView &view) {
+  const int32_t left = view.centerX - SIZE / 2, top = view.centerY - SIZE / 2;
+  for (int32_t y = 0; y < SIZE; y++) {
+    for (int32_t x = 0; x < SIZE; x++) buf[y * SIZE + x] = levelPixel(0, left + x, top + y) ? 3 : 0;
+  }
+}
+
+// A pan east one pixel per frame through every bit alignment, with the tiles
+// cached as they are between frames of a pan
+static void test_pan_benchmark(void) {
+  std::vector<uint8_t> buf(SIZE * SIZE);
+  SpanTarget t = { buf.data(), SIZE, SIZE, nullptr, 8, SIZE, nullptr };
+  MapView view = { 1000, 900, 0, 0 };
+  const int frames = 64;
+  int frame = 0;
+  renderer.render(t, view, 3, 0);
+  const double fast = bench::microsPer(frames * 4, [&] {
+    view.centerX = 1000 + frame++ % frames;
+    renderer.render(t, view, 3, 0);
+  });
+  bench::keep(buf[SIZE * SIZE / 2]);
+  frame = 0;
+  const double slow = bench::microsPer(frames, [&] {
+    view.centerX = 1000 + frame++ % frames;
+    renderPerPixel(buf, view);
+  });
+  bench::keep(buf[SIZE * SIZE / 2]);
+  bench::report("1:1 pan: %.1f us/frame, per-pixel lookups %.1f us/frame", fast, slow);
+  TEST_ASSERT_TRUE(fast < slow);
+
+  // cost only depends on the panel, not on the zoom or the offset
+  for (int8_t zoom = MapRenderer<16>::MIN_ZOOM; zoom <= MapRenderer<16>::MAX_ZOOM; zoom++) {
+    view.zoom = zoom;
+    frame = 0;
+    const double us = bench::microsPer(frames * 4, [&] {
+      view.centerX = 1000 + frame++ % frames;
+      renderer.render(t, view, 3, 0);
+    });
+    bench::report("zoom %d pan: %.1f us/frame", zoom, us);
+  }
+}
+
+// Headings the rotated path is checked at: the axes, a diagonal and an odd angle
+static const int16_t HEADINGS[] = { 0, 45, 90, 137 };
+
+// Screen 1's frame as palette indices, one byte per pixel
+static std::vector<uint8_t> render4(const MapView &view) {
+  std::vector<uint8_t> buf(SIZE * SIZE / 2, 0);
+  SpanTarget t = { buf.data(), SIZE, SIZE, nullptr, 4, SIZE / 2, nullptr };
+  renderer.render(t, view, palette::MAP_INDEX_FG, palette::MAP_INDEX_BG);
+  std::vector<uint8_t> indices(SIZE * SIZE);
+  for (int32_t i = 0; i < SIZE * SIZE; i++) indices[i] = (buf[i / 2] >> (i & 1 ? 0 : 4)) & 15;
+  return indices;
+}
+
+static void checkGolden(int16_t heading, int8_t zoom) {
+  char name[40];
+  snprintf(name, sizeof(name), "map_heading%03d_zoom%+d.pgm", heading, zoom);
+  golden::check(name, golden::pgm(SIZE, SIZE, 15, render4({ 1200, 800, zoom, heading })));
+}
+
+// Every heading at 1:1, and the odd angle on a reduced level and magnified
+static void test_heading_up_goldens(void) {
+  for (int16_t heading : HEADINGS) checkGolden(heading, 0);
+  checkGolden(137, -1);
+  checkGolden(137, 1);
+}
+
+// Level pixel under each screen pixel's centre, the panel turned by the heading
+// in doubles; only pixels whose centre lands within 1/64 px of a source pixel
+// edge may come out on the other side of it
+static void test_heading_up_matches_float_rotation(void) {
+  for (int16_t heading = 1; heading < 360; heading += 17) {
+    for (int8_t zoom = -2; zoom <= 2; zoom++) {
+      const MapView view = { 1500, 700, zoom, heading };
+      const std::vector<uint8_t> got = render8(view);
+      const uint8_t level = zoom < 0 ? -zoom : 0, mag = zoom > 0 ? zoom : 0;
+      const double c = cos(heading * M_PI / 180), s = sin(heading * M_PI / 180);
+      for (int32_t y = 0; y < SIZE; y++) {
+        int32_t x0, x1;
+        roundSpan(SIZE, SIZE, y, x0, x1);
+        for (int32_t x = x0; x <= x1; x++) {
+          const double dx = x + 0.5 - SIZE / 2, dy = y + 0.5 - SIZE / 2;
+          const double u = (view.centerX >> level) + (dx * c - dy * s) / (1 << mag);
+          const double v = (view.centerY >> level) + (dx * s + dy * c) / (1 << mag);
+          const double eu = u - floor(u), ev = v - floor(v);
+          if (eu < 1 / 64.0 || eu > 63 / 64.0 || ev < 1 / 64.0 || ev > 63 / 64.0) continue;
+          uint8_t expected = levelPixel(level, (int32_t)floor(u), (int32_t)floor(v));
+          if (level == 0) expected *= 3;
+          if (got[y * SIZE + x] != expected) {
+            char msg[100];
+            snprintf(msg, sizeof(msg), "heading %d zoom %d: pixel %d,%d is %u, expected %u", heading, zoom, (int)x,
+                     (int)y, got[y * SIZE + x], expected);
+            TEST_FAIL_MESSAGE(msg);
+          }
+        }
+      }
+    }
+  }
+}
+
+// Per-frame cost of the rotated path on screen 1's 4-bit frame, against north up
+static void test_heading_up_benchmark(void) {
+  std::vector<uint8_t> buf(SIZE * SIZE / 2);
+  SpanTarget t = { buf.data(), SIZE, SIZE, nullptr, 4, SIZE / 2, nullptr };
+  for (int16_t heading : HEADINGS) {
+    MapView view = { 1000, 900, 0, heading };
+    int frame = 0;
+    renderer.render(t, view, palette::MAP_INDEX_FG, palette::MAP_INDEX_BG);
+    const double us = bench::microsPer(256, [&] {
+      view.centerX = 1000 + frame++ % 64; // panning, as while riding
+      renderer.render(t, view, palette::MAP_INDEX_FG, palette::MAP_INDEX_BG);
+    });
+    bench::keep(buf[SIZE * SIZE / 4]);
+    bench::report("heading %3d: %.1f us/frame%s", heading, us, heading ? "" : " (north-up path)");
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_matches_reference);
+  RUN_TEST(test_packed_target);
+  RUN_TEST(test_pan_benchmark);
+  RUN_TEST(test_heading_up_goldens);
+  RUN_TEST(test_heading_up_matches_float_rotation);
+  RUN_TEST(test_heading_up_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,71 @@
+// Compile-time colours: the shock ramp runs green to red without reversing in
+// either format, and every RGB332 colour is what TFT_eSPI's color16to8() makes
+// of its RGB565 twin, so a colour looks the same however it reaches a sprite.
+#include <unity.h>
+#include <TFT_eSPI.h>
+#include <palette.h>
+#include <screens.h>
+
+using namespace palette;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static uint8_t red565(uint16_t c) { return c >> 11; }
+static uint8_t green565(uint16_t c) { return (c >> 5) & 0x3F; }
+static uint8_t blue565(uint16_t c) { return c & 0x1F; }
+static uint8_t red332(uint8_t c) { return c >> 5; }
+static uint8_t green332(uint8_t c) { return (c >> 2) & 0x07; }
+static uint8_t blue332(uint8_t c) { return c & 0x03; }
+
+static void test_ramp_ends(void) {
+  TEST_ASSERT_EQUAL_HEX16(0x07E0, shockRamp.c565[0]); // green
+  TEST_ASSERT_EQUAL_HEX16(0xF800, shockRamp.c565[SHOCK_STEPS - 1]); // red
+  TEST_ASSERT_EQUAL_HEX8(0x1C, shockRamp.c332[0]);
+  TEST_ASSERT_EQUAL_HEX8(0xE0, shockRamp.c332[SHOCK_STEPS - 1]);
+  TEST_ASSERT_EQUAL_HEX16(shockRamp.c565[0], shock565(-5));
+  TEST_ASSERT_EQUAL_HEX16(shockRamp.c565[SHOCK_STEPS - 1], shock565(250));
+}
+
+// Red never falls and green never rises from one step to the next, and there
+// is no blue
+static void test_ramp_monotonic(void) {
+  for (uint8_t i = 1; i < SHOCK_STEPS; i++) {
+    const uint16_t a = shockRamp.c565[i - 1], b = shockRamp.c565[i];
+    TEST_ASSERT_TRUE(red565(b) >= red565(a));
+    TEST_ASSERT_TRUE(green565(b) <= green565(a));
+    TEST_ASSERT_EQUAL_UINT8(0, blue565(b));
+    const uint8_t a8 = shockRamp.c332[i - 1], b8 = shockRamp.c332[i];
+    TEST_ASSERT_TRUE(red332(b8) >= red332(a8));
+    TEST_ASSERT_TRUE(green332(b8) <= green332(a8));
+    TEST_ASSERT_EQUAL_UINT8(0, blue332(b8));
+  }
+  TEST_ASSERT_TRUE(rampMonotonic());
+}
+
+static void test_ramp_matches_color16to8(void) {
+  for (uint8_t i = 0; i < SHOCK_STEPS; i++) {
+    TEST_ASSERT_EQUAL_HEX8(tft.color16to8(shockRamp.c565[i]), shockRamp.c332[i]);
+  }
+}
+
+static void test_colours_match_color16to8(void) {
+  const Colour colours[] = { BACKGROUND, NEEDLE, COMPASS_NORTH, COMPASS_OTHER, TICK, BOOST_LOW,
+                             BOOST_MID, BOOST_HIGH, SCOOTER, MAP_FG, MAP_BG, RIDER };
+  for (const Colour &c : colours) TEST_ASSERT_EQUAL_HEX8(tft.color16to8(c.c565), c.c332);
+}
+
+// to332() agrees with color16to8() on every RGB565 value, not just the ones in use
+static void test_to332_matches_color16to8(void) {
+  for (uint32_t c = 0; c <= 0xFFFF; c++) TEST_ASSERT_EQUAL_HEX8(tft.color16to8((uint16_t)c), to332((uint16_t)c));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_ramp_ends);
+  RUN_TEST(test_ramp_monotonic);
+  RUN_TEST(test_ramp_matches_color16to8);
+  RUN_TEST(test_colours_match_color16to8);
+  RUN_TEST(test_to332_matches_color16to8);
+  return UNITY_END();
+}
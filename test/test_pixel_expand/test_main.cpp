@@ -0,0 +1,105 @@
+// Sprite pixels to the panel's byte-swapped RGB565: both expansions against
+// the colour each pixel should have, and a full frame of each timed, as the
+// frame pipeline sends it.
+#include <vector>
+#include <unity.h>
+#include <TFT_eSPI.h>
+#include <screens.h>
+#include <palette.h>
+#include <pixel_expand.h>
+#include "../bench.h"
+
+static const int32_t W = 240, H = 240;
+
+static uint16_t lut[256];
+static uint32_t pairs[256];
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_swap(void) {
+  TEST_ASSERT_EQUAL_HEX16(0x3412, pixels::swap565(0x1234));
+  TEST_ASSERT_EQUAL_HEX16(0xF800, pixels::swap565(0x00F8));
+}
+
+// Every RGB332 value becomes the swapped RGB565 colour of the sprite's conversion
+static void test_expand8(void) {
+  uint8_t src[256];
+  for (int i = 0; i < 256; i++) src[i] = (uint8_t)i;
+  uint16_t out[256];
+  pixels::expand8(src, out, 256, lut);
+  for (int i = 0; i < 256; i++) TEST_ASSERT_EQUAL_HEX16(pixels::swap565(tft.color8to16((uint8_t)i)), out[i]);
+}
+
+// Every byte of a 4-bit sprite becomes its two palette colours, high nibble first in memory
+static void test_expand4(void) {
+  uint8_t src[256];
+  for (int i = 0; i < 256; i++) src[i] = (uint8_t)i;
+  std::vector<uint32_t> line(256); // 4-byte aligned
+  uint16_t *out = (uint16_t *)line.data();
+  pixels::expand4(src, out, 256, pairs);
+  for (int i = 0; i < 256; i++) {
+    TEST_ASSERT_EQUAL_HEX16(pixels::swap565(palette::screen1Palette[i >> 4]), out[2 * i]);
+    TEST_ASSERT_EQUAL_HEX16(pixels::swap565(palette::screen1Palette[i & 15]), out[2 * i + 1]);
+  }
+}
+
+// A sprite drawn with palette indices expands to the colours the host panel
+// shows after pushing the same sprite
+static void test_expand4_matches_sprite_push(void) {
+  TFT_eSprite spr(&tft);
+  spr.setColorDepth(4);
+  spr.createSprite(W, H);
+  spr.createPalette(palette::screen1Palette, 16);
+  for (int32_t y = 0; y < H; y++) {
+    for (int32_t x = 0; x < W; x++) spr.drawPixel(x, y, (x * 7 + y * 3) & 15);
+  }
+  tft.init();
+  tft.selectPanel(1);
+  spr.pushSprite(0, 0);
+  std::vector<uint32_t> line32(W / 2);
+  uint16_t *line = (uint16_t *)line32.data();
+  const uint8_t *px = (const uint8_t *)spr.getPointer();
+  for (int32_t y = 0; y < H; y++) {
+    pixels::expand4(px + y * W / 2, line, W / 2, pairs);
+    for (int32_t x = 0; x < W; x++) TEST_ASSERT_EQUAL_HEX16(tft.panelPixels(1)[y * W + x], pixels::swap565(line[x]));
+  }
+}
+
+// One full frame each, a line at a time; the 4-bit sprite is half the bytes to read
+static void test_benchmark(void) {
+  std::vector<uint8_t> px8((size_t)W * H), px4((size_t)W * H / 2);
+  for (size_t i = 0; i < px8.size(); i++) px8[i] = (uint8_t)(i * 7);
+  for (size_t i = 0; i < px4.size(); i++) px4[i] = (uint8_t)(i * 13);
+  std::vector<uint32_t> line32(W / 2); // 4-byte aligned, as the DMA line buffers are
+  uint16_t *line = (uint16_t *)line32.data();
+  uint32_t sum = 0;
+  const double us8 = bench::microsPer(500, [&] {
+    for (int32_t y = 0; y < H; y++) {
+      pixels::expand8(&px8[y * W], line, W, lut);
+      sum += line[y % W];
+    }
+  });
+  const double us4 = bench::microsPer(500, [&] {
+    for (int32_t y = 0; y < H; y++) {
+      pixels::expand4(&px4[y * W / 2], line, W / 2, pairs);
+      sum += line[y % W];
+    }
+  });
+  bench::keep(sum);
+  bench::report("push expand 8-bit: %.1f us/frame, %u B sprite", us8, (unsigned)px8.size());
+  bench::report("push expand 4-bit: %.1f us/frame, %u B sprite", us4, (unsigned)px4.size());
+  TEST_ASSERT_TRUE(us4 < us8);
+}
+
+int main() {
+  for (int i = 0; i < 256; i++) lut[i] = pixels::swap565(tft.color8to16((uint8_t)i));
+  pixels::buildPairLut(pairs, palette::screen1Palette);
+  UNITY_BEGIN();
+  RUN_TEST(test_swap);
+  RUN_TEST(test_expand8);
+  RUN_TEST(test_expand4);
+  RUN_TEST(test_expand4_matches_sprite_push);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
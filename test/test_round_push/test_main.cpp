@@ -0,0 +1,112 @@
+// Pushes to the round panels: the visible circle, the windows a dirty region
+// is cut into around it, and the pixels and bytes a full frame saves against
+// the square one.
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <unity.h>
+#include <dirty_rects.h>
+#include <round_mask.h>
+#include <sprite_spans.h>
+#include <shock_noise.h>
+
+static const int16_t SIZE = ROUND_SIZE;
+
+static bool visible(int32_t x, int32_t y) { return x >= roundMask.x0[y] && x <= roundMask.x1[y]; }
+
+// How many windows of `region` cover each pixel of the frame
+static std::vector<uint8_t> coverage(const DirtyRegion &region) {
+  std::vector<uint8_t> n(SIZE * SIZE, 0);
+  region.forEachWindow([&](const DirtyRect &w) {
+    for (int32_t y = w.y; y < w.bottom(); y++) {
+      for (int32_t x = w.x; x < w.right(); x++) n[y * SIZE + x]++;
+    }
+  });
+  return n;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Symmetric about both axes, and the circle's area to within a pixel at each end of a row
+static void test_mask_is_the_panel_circle(void) {
+  for (int32_t y = 0; y < SIZE; y++) {
+    TEST_ASSERT_EQUAL_INT16(SIZE - 1 - roundMask.x1[y], roundMask.x0[y]);
+    TEST_ASSERT_EQUAL_INT16(roundMask.x0[SIZE - 1 - y], roundMask.x0[y]);
+    TEST_ASSERT_TRUE(roundMask.x0[y] >= 0 && roundMask.x1[y] < SIZE);
+    int32_t x0, x1;
+    roundSpan(SIZE, SIZE, y, x0, x1);
+    TEST_ASSERT_EQUAL_INT32(roundMask.x0[y], x0);
+  }
+  TEST_ASSERT_UINT32_WITHIN(2 * SIZE, (uint32_t)(M_PI * SIZE * SIZE / 4), roundMask.visiblePixels());
+}
+
+// Random dirty rects: every visible pixel of them is sent as often as a square
+// panel's region sends it (once per rect over it, rects may overlap), and no
+// pixel outside them is sent
+static void test_windows_cover_visible_pixels(void) {
+  shocknoise::XorShift32 rng(18);
+  for (int run = 0; run < 300; run++) {
+    DirtyRegion round(SIZE, SIZE, true), square(SIZE, SIZE, false);
+    std::vector<uint8_t> dirty(SIZE * SIZE, 0);
+    for (int n = 1 + rng.below(5); n--;) {
+      const int32_t x = rng.below(SIZE), y = rng.below(SIZE), w = 1 + rng.below(120), h = 1 + rng.below(120);
+      round.add(x, y, w, h);
+      square.add(x, y, w, h);
+    }
+    // the merged rects, as the square region sends them
+    const std::vector<uint8_t> rects = coverage(square);
+    const std::vector<uint8_t> sent = coverage(round);
+    for (int32_t y = 0; y < SIZE; y++) {
+      for (int32_t x = 0; x < SIZE; x++) {
+        if (visible(x, y)) TEST_ASSERT_EQUAL_UINT8(rects[y * SIZE + x], sent[y * SIZE + x]);
+        else TEST_ASSERT_TRUE(sent[y * SIZE + x] <= rects[y * SIZE + x]); // only corners the band widened over
+      }
+    }
+  }
+}
+
+// A full frame: 20% fewer bytes on the bus, commands included
+static void test_full_frame(void) {
+  uint32_t px[2] = {}, bytes[2] = {}, windows[2] = {};
+  for (int round = 0; round < 2; round++) {
+    DirtyRegion full(SIZE, SIZE, round);
+    full.addAll();
+    full.forEachWindow([&](const DirtyRect &w) {
+      px[round] += w.area();
+      bytes[round] += w.area() * 2 + DirtyRegion::WINDOW_OVERHEAD_BYTES;
+      windows[round]++;
+    });
+  }
+  char msg[160];
+  snprintf(msg, sizeof(msg), "full frame: square %u px %u B, round %u px %u B in %u windows (visible %u px), %.1f%% fewer bytes",
+           px[0], bytes[0], px[1], bytes[1], windows[1], roundMask.visiblePixels(), 100.0 * (bytes[0] - bytes[1]) / bytes[0]);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_EQUAL_UINT32(SIZE * SIZE, px[0]);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(roundMask.visiblePixels(), px[1]);
+  TEST_ASSERT_TRUE(bytes[1] * 100 < bytes[0] * 80);
+}
+
+// Spans drawn through a masked target stop at the circle, and everything they drew is reported dirty
+static void test_spans_clip_to_circle(void) {
+  std::vector<uint8_t> buf(SIZE * SIZE, 0);
+  DirtyRegion dirty(SIZE, SIZE);
+  SpanTarget t = { buf.data(), SIZE, SIZE, &dirty, 8, SIZE, &roundMask };
+  for (int32_t y = -2; y < SIZE + 2; y++) t.hspan(y, -10, SIZE + 10, 0xFF);
+  const std::vector<uint8_t> reported = coverage(dirty);
+  for (int32_t y = 0; y < SIZE; y++) {
+    for (int32_t x = 0; x < SIZE; x++) {
+      TEST_ASSERT_EQUAL_UINT8(visible(x, y) ? 0xFF : 0, buf[y * SIZE + x]);
+      if (visible(x, y)) TEST_ASSERT_TRUE(reported[y * SIZE + x] > 0);
+    }
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_mask_is_the_panel_circle);
+  RUN_TEST(test_windows_cover_visible_pixels);
+  RUN_TEST(test_full_frame);
+  RUN_TEST(test_spans_clip_to_circle);
+  return UNITY_END();
+}
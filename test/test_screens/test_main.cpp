@@ -0,0 +1,69 @@
+// Golden-image regression of updateScreen0()/updateScreen1(): renders the same
+// demo motion as the native program and compares the panels with test/golden/.
+#include <unity.h>
+#include <TFT_eSPI.h>
+#include <dirty_rects.h>
+#include <screens.h>
+#include "../golden.h"
+
+static const int DEMO_FRAMES = 120;
+
+static TFT_eSprite img(&tft), img2(&tft);
+static DirtyTracker dirty0(240, 240, true), dirty1(240, 240, true);
+
+static void renderFrame(uint8_t panel, void (*render)(TFT_eSprite &, DirtyTracker &), TFT_eSprite &spr,
+                        DirtyTracker &dirty) {
+  render(spr, dirty);
+  tft.selectPanel(panel);
+  dirty.push(spr);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Both screens, partial pushes included, for DEMO_FRAMES frames of demo sensor values as in loop()
+static void test_demo_renders(void) {
+  tft.init();
+  img.setColorDepth(8);
+  img2.setColorDepth(4);
+  TEST_ASSERT_NOT_NULL(img.createSprite(tft.width(), tft.height()));
+  TEST_ASSERT_NOT_NULL(img2.createSprite(tft.width(), tft.height()));
+  img2.createPalette(palette::screen1Palette, 16);
+  TEST_ASSERT_TRUE(prepareScreen0Layers());
+  for (int f = 0; f < DEMO_FRAMES; f++) {
+    renderFrame(0, updateScreen0, img, dirty0);
+    renderFrame(1, updateScreen1, img2, dirty1);
+    compassValue = (compassValue + 1) % 360;
+    shockSensorBackValue = shockSensorBackValue + 8 > 256 ? 0 : shockSensorBackValue + 8;
+    shockSensorFrontValue = shockSensorFrontValue + 8 > 256 ? 0 : shockSensorFrontValue + 8;
+    mapView.centerX = mapView.centerX + 1 < MAP_WIDTH ? mapView.centerX + 1 : 0;
+    mapView.heading = mapHeadingUp ? compassValue : 0;
+  }
+}
+
+// Both panels push their dirty windows of the visible circle only
+static void test_demo_push_size(void) {
+  const double perFrame = (double)tft.pixelsWritten() / DEMO_FRAMES;
+  char msg[100];
+  snprintf(msg, sizeof(msg), "demo run: %.0f px/frame pushed for both panels, square frames would be %d", perFrame,
+           2 * tft.width() * tft.height());
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(perFrame < 2 * roundMask.visiblePixels());
+}
+
+static void test_screen0_matches_golden(void) {
+  golden::check("screen0.ppm", tft.encodePPM(0));
+}
+
+static void test_screen1_matches_golden(void) {
+  golden::check("screen1.ppm", tft.encodePPM(1));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_demo_renders);
+  RUN_TEST(test_demo_push_size);
+  RUN_TEST(test_screen0_matches_golden);
+  RUN_TEST(test_screen1_matches_golden);
+  return UNITY_END();
+}
@@ -0,0 +1,102 @@
+// The mask-based shock gradient against the drawPixel loop it replaced:
+// the same pixels at every intensity, and the time each takes per frame.
+#include <string.h>
+#include <unity.h>
+#include <TFT_eSPI.h>
+#include <screens.h>
+#include <shock_gradient.h>
+#include "../bench.h"
+
+static TFT_eSprite pixelSprite(&tft), maskSprite(&tft);
+
+// The gradient as it was drawn before shock_gradient.h, one drawPixel per cell and side
+static void drawShockPixels(TFT_eSprite &spr, const ShockGradient &g, uint16_t back, uint16_t front) {
+  shocknoise::XorShift32 rng;
+  uint8_t thresholds[SHOCK_ROWS];
+  for (int dx = 1; dx <= SHOCK_REACH; dx++) {
+    int denom = dx / 4 ? dx / 4 : 1;
+    shocknoise::fillRow(shocknoise::DITHER, rng, dx, thresholds, SHOCK_ROWS);
+    for (int dy = 0; dy < SHOCK_ROWS; dy++) {
+      if (thresholds[dy] < g.pct / denom) {
+        spr.drawPixel(g.cx + dx, g.backY + dy, back);
+        spr.drawPixel(g.cx + dx, g.frontY + dy, front);
+        spr.drawPixel(g.cx - dx, g.backY + dy, back);
+        spr.drawPixel(g.cx - dx, g.frontY + dy, front);
+      }
+    }
+  }
+}
+
+static ShockGradient gradient(uint8_t pct) {
+  const ShockGradient g = { 120, 165, 120, pct, maskSprite.color16to8(TFT_RED), maskSprite.color16to8(TFT_GREEN) };
+  return g;
+}
+
+static size_t frameBytes() { return (size_t)maskSprite.width() * maskSprite.height(); }
+
+void setUp(void) {
+  pixelSprite.fillSprite(TFT_BLACK);
+  maskSprite.fillSprite(TFT_BLACK);
+}
+void tearDown(void) {}
+
+// Same pixels as the drawPixel loop at every intensity, screen 0's placement
+static void test_matches_pixel_loop(void) {
+  shocknoise::XorShift32 rng;
+  for (int pct = 0; pct <= 100; pct++) {
+    const ShockGradient g = gradient((uint8_t)pct);
+    drawShockPixels(pixelSprite, g, TFT_RED, TFT_GREEN);
+    SpanTarget target = spanTarget(maskSprite);
+    drawShockGradient(target, g, shocknoise::DITHER, rng);
+    if (memcmp(pixelSprite.getPointer(), maskSprite.getPointer(), frameBytes()) != 0) {
+      char msg[40];
+      snprintf(msg, sizeof(msg), "differs at %d%%", pct);
+      TEST_FAIL_MESSAGE(msg);
+    }
+  }
+}
+
+// A gradient that would not fit the sprite is not drawn at all, nor one of 0%
+static void test_draws_nothing_out_of_bounds(void) {
+  shocknoise::XorShift32 rng;
+  SpanTarget target = spanTarget(maskSprite);
+  ShockGradient g = gradient(100);
+  const ShockGradient bad[] = {
+    { SHOCK_REACH - 1, g.backY, g.frontY, 100, g.backColor, g.frontColor },
+    { (int16_t)(240 - SHOCK_REACH), g.backY, g.frontY, 100, g.backColor, g.frontColor },
+    { g.cx, -1, g.frontY, 100, g.backColor, g.frontColor },
+    { g.cx, g.backY, (int16_t)(240 - SHOCK_ROWS + 1), 100, g.backColor, g.frontColor },
+    { g.cx, g.backY, g.frontY, 0, g.backColor, g.frontColor },
+  };
+  for (const ShockGradient &b : bad) drawShockGradient(target, b, shocknoise::DITHER, rng);
+  const uint8_t *px = (const uint8_t *)maskSprite.getPointer();
+  for (size_t i = 0; i < frameBytes(); i++) TEST_ASSERT_EQUAL_UINT8(0, px[i]);
+}
+
+// Per-frame time of both at each intensity, 0..100% in steps of 10
+static void test_benchmark(void) {
+  shocknoise::XorShift32 rng;
+  SpanTarget target = spanTarget(maskSprite);
+  double pixelTotal = 0, maskTotal = 0;
+  for (int pct = 0; pct <= 100; pct += 10) {
+    const ShockGradient g = gradient((uint8_t)pct);
+    const double pixelUs = bench::microsPer(500, [&] { drawShockPixels(pixelSprite, g, TFT_RED, TFT_GREEN); });
+    const double maskUs = bench::microsPer(500, [&] { drawShockGradient(target, g, shocknoise::DITHER, rng); });
+    bench::report("shock gradient %3d%%: pixels %.2f us, mask %.2f us", pct, pixelUs, maskUs);
+    pixelTotal += pixelUs;
+    maskTotal += maskUs;
+  }
+  TEST_ASSERT_TRUE(maskTotal < pixelTotal);
+}
+
+int main() {
+  pixelSprite.setColorDepth(8);
+  maskSprite.setColorDepth(8);
+  pixelSprite.createSprite(tft.width(), tft.height());
+  maskSprite.createSprite(tft.width(), tft.height());
+  UNITY_BEGIN();
+  RUN_TEST(test_matches_pixel_loop);
+  RUN_TEST(test_draws_nothing_out_of_bounds);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
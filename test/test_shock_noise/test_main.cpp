@@ -0,0 +1,97 @@
+// Threshold sources of the shock gradient: the dither mask lights the share
+// of cells its density asks for, evenly; seeded xorshift repeats; and what
+// each source costs per frame against the rand() it replaced.
+#include <stdlib.h>
+#include <unity.h>
+#include <shock_noise.h>
+#include "../bench.h"
+
+using namespace shocknoise;
+
+void setUp(void) {}
+void tearDown(void) {}
+
+// Each Bayer index appears once in the 16x16 mask
+static void test_bayer_indices_are_a_permutation(void) {
+  bool seen[256] = {};
+  for (uint8_t y = 0; y < MASK_SIZE; y++) {
+    for (uint8_t x = 0; x < MASK_SIZE; x++) {
+      const uint8_t i = bayerIndex(x, y);
+      TEST_ASSERT_FALSE(seen[i]);
+      seen[i] = true;
+    }
+  }
+}
+
+// A density of d lights d / RANGE of the cells, to within one cell of the
+// tile, and every 4x4 block of the mask within one cell of its share
+static void test_dither_density(void) {
+  for (uint8_t d = 0; d <= RANGE; d++) {
+    uint32_t lit = 0;
+    uint32_t block[4][4] = {};
+    for (uint8_t y = 0; y < MASK_SIZE; y++) {
+      for (uint8_t x = 0; x < MASK_SIZE; x++) {
+        const bool on = ditherMask.t[y][x] < d;
+        lit += on;
+        block[y / 4][x / 4] += on;
+      }
+    }
+    TEST_ASSERT_UINT32_WITHIN(1, (d * 256 + RANGE / 2) / RANGE, lit);
+    for (uint8_t y = 0; y < 4; y++) {
+      for (uint8_t x = 0; x < 4; x++) TEST_ASSERT_INT_WITHIN(1, (int)(lit + 8) / 16, (int)block[y][x]);
+    }
+  }
+}
+
+static void test_fill_row(void) {
+  XorShift32 rng(5);
+  uint8_t row[40];
+  fillRow(DITHER, rng, 17, row, 40);
+  for (int i = 0; i < 40; i++) TEST_ASSERT_EQUAL_UINT8(ditherMask.t[1][i % MASK_SIZE], row[i]);
+  for (int r = 0; r < 100; r++) {
+    fillRow(XORSHIFT, rng, r, row, 40);
+    for (uint8_t t : row) TEST_ASSERT_LESS_THAN(RANGE, t);
+  }
+}
+
+// Seeded, xorshift gives the same thresholds every frame
+static void test_seeded_xorshift_repeats(void) {
+  uint8_t a[15], b[15];
+  XorShift32 first(1234), second(1234);
+  for (int row = 0; row < 90; row++) {
+    fillRow(XORSHIFT, first, row, a, 15);
+    fillRow(XORSHIFT, second, row, b, 15);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(a, b, 15);
+  }
+  TEST_ASSERT_NOT_EQUAL(0, XorShift32(0).state); // a zero seed would stick at zero
+}
+
+// Thresholds for one gradient frame, 89 rows of 15 cells, per source
+static void test_benchmark(void) {
+  static const char *const names[] = { "dither", "xorshift", "rand" };
+  double us[3];
+  XorShift32 rng(1);
+  uint8_t thresholds[15];
+  for (uint8_t mode = DITHER; mode <= LIBC_RAND; mode++) {
+    uint32_t sum = 0;
+    us[mode] = bench::microsPer(2000, [&] {
+      for (int row = 1; row < 90; row++) {
+        fillRow((Mode)mode, rng, row, thresholds, 15);
+        for (uint8_t t : thresholds) sum += t;
+      }
+    });
+    bench::keep(sum);
+    bench::report("shock noise %s: %.2f us/frame", names[mode], us[mode]);
+  }
+  TEST_ASSERT_TRUE(us[DITHER] < us[LIBC_RAND]);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_bayer_indices_are_a_permutation);
+  RUN_TEST(test_dither_density);
+  RUN_TEST(test_fill_row);
+  RUN_TEST(test_seeded_xorshift_repeats);
+  RUN_TEST(test_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,188 @@
+// Telemetry queue: the ring's full and empty behaviour on one thread, then a
+// producer thread standing in for the NimBLE task, sending bursts of packets
+// through the same decode-and-push path as onTelemetry(), while the consumer
+// drains like loop() does. Every sample the consumer sees must be intact and
+// newer than the last; nothing but counted drops may go missing, and a
+// consumer that stalled must end on the last packet pushed.
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unity.h>
+#include <shock_noise.h>
+#include <spsc_ring.h>
+#include <telemetry.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+typedef SpscRing<Telemetry, 16> Queue;
+
+static Telemetry sample(uint32_t seq) {
+  return { (uint16_t)seq, (uint16_t)(seq * 7), (uint8_t)(seq % 101), (int16_t)(seq * 3) };
+}
+
+static bool intact(const Telemetry &t) {
+  const uint16_t seq = t.seq;
+  return t.speedCentiKmh == (uint16_t)(seq * 7) && t.batteryPct == seq % 101 && t.motorTempDeciC == (int16_t)(seq * 3);
+}
+
+static void test_push_fails_when_full(void) {
+  Queue q;
+  Telemetry t;
+  TEST_ASSERT_FALSE(q.pop(t));
+  for (uint32_t i = 0; i < Queue::capacity(); i++) TEST_ASSERT_TRUE(q.push(sample(i)));
+  TEST_ASSERT_FALSE(q.push(sample(99)));
+  TEST_ASSERT_EQUAL_UINT32(Queue::capacity(), q.size());
+  TEST_ASSERT_EQUAL_UINT32(1, q.dropped());
+  for (uint32_t i = 0; i < Queue::capacity(); i++) {
+    TEST_ASSERT_TRUE(q.pop(t));
+    TEST_ASSERT_EQUAL_UINT16(i, t.seq);
+  }
+  TEST_ASSERT_FALSE(q.pop(t));
+}
+
+static void test_push_overwrite_drops_oldest(void) {
+  Queue q;
+  for (uint32_t i = 0; i < Queue::capacity() + 5; i++) q.pushOverwrite(sample(i));
+  TEST_ASSERT_EQUAL_UINT32(Queue::capacity(), q.size());
+  TEST_ASSERT_EQUAL_UINT32(Queue::capacity() + 5, q.pushed());
+  TEST_ASSERT_EQUAL_UINT32(5, q.dropped());
+  Telemetry t;
+  for (uint32_t i = 5; i < Queue::capacity() + 5; i++) {
+    TEST_ASSERT_TRUE(q.pop(t));
+    TEST_ASSERT_EQUAL_UINT16(i, t.seq);
+    TEST_ASSERT_TRUE(intact(t));
+  }
+  TEST_ASSERT_FALSE(q.pop(t));
+}
+
+// The render loop stalls while a burst arrives: with pushOverwrite() it
+// resumes on the newest packet, where push() would have kept the first 16
+static void test_stalled_consumer_ends_on_last_pushed(void) {
+  Queue overwrite, drop;
+  for (uint32_t i = 0; i < 1000; i++) {
+    overwrite.pushOverwrite(sample(i));
+    drop.push(sample(i));
+  }
+  Telemetry t;
+  TEST_ASSERT_TRUE(overwrite.popLatest(t));
+  TEST_ASSERT_EQUAL_UINT16(999, t.seq);
+  TEST_ASSERT_FALSE(overwrite.popLatest(t));
+  TEST_ASSERT_TRUE(drop.popLatest(t));
+  TEST_ASSERT_EQUAL_UINT16(Queue::capacity() - 1, t.seq);
+}
+
+// Lapping the ring thousands of times, overwriting on every lap, still reads
+// in order and keeps the newest items
+static void test_many_laps(void) {
+  Queue q;
+  Telemetry t;
+  int32_t last = -1;
+  for (uint32_t i = 0; i < 60000; i++) {
+    q.pushOverwrite(sample(i));
+    if (i % 3 == 0) {
+      TEST_ASSERT_TRUE(q.pop(t));
+      TEST_ASSERT_TRUE((int32_t)t.seq > last);
+      last = t.seq;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(Queue::capacity(), q.size());
+  TEST_ASSERT_EQUAL_UINT32(60000, q.pushed());
+  TEST_ASSERT_EQUAL_UINT32(60000 - 20000 - Queue::capacity(), q.dropped());
+}
+
+enum Mode { EVERY, EVERY_OVERWRITE, LATEST_OVERWRITE };
+
+struct Result {
+  uint32_t received, bad, pushed, dropped;
+  int32_t last, lastPushed;
+};
+
+static Result run(Mode mode, uint32_t packets) {
+  Queue queue;
+  std::atomic<bool> done{false};
+  int32_t lastPushed = -1;
+  std::thread producer([&] {
+    shocknoise::XorShift32 rng(mode + 3);
+    uint8_t buf[TELEMETRY_SIZE];
+    for (uint32_t seq = 0; seq < packets;) {
+      for (uint32_t burst = 1 + rng.below(40); burst-- && seq < packets; seq++) {
+        encodeTelemetry(sample(seq), buf, sizeof(buf));
+        Telemetry decoded;
+        if (decodeTelemetry(buf, sizeof(buf), decoded) != TELEMETRY_OK) continue;
+        if (mode == EVERY) {
+          if (queue.push(decoded)) lastPushed = seq;
+        } else {
+          queue.pushOverwrite(decoded);
+          lastPushed = seq;
+        }
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(rng.below(200)));
+    }
+    done = true;
+  });
+  Result r = {};
+  r.last = -1;
+  Telemetry t;
+  auto take = [&] {
+    if (!intact(t) || (int32_t)t.seq <= r.last) r.bad++;
+    r.last = t.seq;
+    r.received++;
+  };
+  for (;;) {
+    const bool finished = done;
+    if (mode == LATEST_OVERWRITE) {
+      if (queue.popLatest(t)) take();
+    } else {
+      while (queue.pop(t)) take();
+    }
+    if (finished && !queue.size()) break;
+    std::this_thread::sleep_for(std::chrono::microseconds(mode == LATEST_OVERWRITE ? 300 : 50));
+  }
+  producer.join();
+  r.pushed = queue.pushed();
+  r.dropped = queue.dropped();
+  r.lastPushed = lastPushed;
+  return r;
+}
+
+static const uint32_t PACKETS = 50000; // fits the 16-bit sequence number
+
+// push(): every packet is either read or counted as dropped
+static void test_threads_every_packet(void) {
+  const Result r = run(EVERY, PACKETS);
+  TEST_ASSERT_EQUAL_UINT32(0, r.bad);
+  TEST_ASSERT_EQUAL_UINT32(PACKETS, r.pushed + r.dropped);
+  TEST_ASSERT_EQUAL_UINT32(r.pushed, r.received);
+  TEST_ASSERT_EQUAL_INT32(r.lastPushed, r.last);
+}
+
+// pushOverwrite(): every packet is queued, and either read or overwritten
+static void test_threads_overwrite(void) {
+  const Result r = run(EVERY_OVERWRITE, PACKETS);
+  TEST_ASSERT_EQUAL_UINT32(0, r.bad);
+  TEST_ASSERT_EQUAL_UINT32(PACKETS, r.pushed);
+  TEST_ASSERT_EQUAL_UINT32(PACKETS, r.received + r.dropped);
+  TEST_ASSERT_EQUAL_INT32(PACKETS - 1, r.last);
+}
+
+// As loop() reads it: popLatest() from a slow consumer ends on the last packet
+static void test_threads_latest(void) {
+  const Result r = run(LATEST_OVERWRITE, PACKETS);
+  TEST_ASSERT_EQUAL_UINT32(0, r.bad);
+  TEST_ASSERT_EQUAL_UINT32(PACKETS, r.pushed);
+  TEST_ASSERT_EQUAL_INT32(PACKETS - 1, r.lastPushed);
+  TEST_ASSERT_EQUAL_INT32(r.lastPushed, r.last);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_push_fails_when_full);
+  RUN_TEST(test_push_overwrite_drops_oldest);
+  RUN_TEST(test_stalled_consumer_ends_on_last_pushed);
+  RUN_TEST(test_many_laps);
+  RUN_TEST(test_threads_every_packet);
+  RUN_TEST(test_threads_overwrite);
+  RUN_TEST(test_threads_latest);
+  return UNITY_END();
+}
@@ -0,0 +1,129 @@
+// Telemetry codec: encode/decode round trip, every single-byte corruption and
+// truncation rejected, newer minor versions accepted, random bytes never
+// decode as a packet unless they happen to pass the CRC.
+#include <string.h>
+#include <unity.h>
+#include <shock_noise.h>
+#include <telemetry.h>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static const int ROUNDS = 20000;
+
+static Telemetry randomTelemetry(shocknoise::XorShift32 &rng) {
+  return { (uint16_t)rng.next(), (uint16_t)rng.next(), (uint8_t)rng.below(101), (int16_t)rng.next() };
+}
+
+static void test_round_trip(void) {
+  shocknoise::XorShift32 rng(12345);
+  uint8_t buf[TELEMETRY_SIZE];
+  for (int i = 0; i < ROUNDS; i++) {
+    const Telemetry in = randomTelemetry(rng);
+    TEST_ASSERT_EQUAL_UINT32(TELEMETRY_SIZE, encodeTelemetry(in, buf, sizeof(buf)));
+    Telemetry out = {};
+    TEST_ASSERT_EQUAL_UINT8(TELEMETRY_OK, decodeTelemetry(buf, sizeof(buf), out));
+    TEST_ASSERT_EQUAL_UINT16(in.seq, out.seq);
+    TEST_ASSERT_EQUAL_UINT16(in.speedCentiKmh, out.speedCentiKmh);
+    TEST_ASSERT_EQUAL_UINT8(in.batteryPct, out.batteryPct);
+    TEST_ASSERT_EQUAL_INT16(in.motorTempDeciC, out.motorTempDeciC);
+  }
+}
+
+static void test_encode_needs_room(void) {
+  uint8_t buf[TELEMETRY_SIZE];
+  const Telemetry t = {};
+  TEST_ASSERT_EQUAL_UINT32(0, encodeTelemetry(t, buf, TELEMETRY_SIZE - 1));
+}
+
+// Any one byte changed must not decode, and out is left alone
+static void test_corruption_rejected(void) {
+  shocknoise::XorShift32 rng(2);
+  uint8_t buf[TELEMETRY_SIZE];
+  for (int i = 0; i < ROUNDS; i++) {
+    encodeTelemetry(randomTelemetry(rng), buf, sizeof(buf));
+    buf[rng.below(TELEMETRY_SIZE)] ^= (uint8_t)(rng.below(255) + 1);
+    Telemetry out = { 1, 2, 3, 4 };
+    TEST_ASSERT_NOT_EQUAL(TELEMETRY_OK, decodeTelemetry(buf, sizeof(buf), out));
+    TEST_ASSERT_EQUAL_UINT16(1, out.seq);
+    TEST_ASSERT_EQUAL_INT16(4, out.motorTempDeciC);
+  }
+}
+
+static void test_truncation_rejected(void) {
+  uint8_t buf[TELEMETRY_SIZE];
+  encodeTelemetry({ 7, 1234, 56, -78 }, buf, sizeof(buf));
+  Telemetry out;
+  for (size_t len = 0; len < TELEMETRY_SIZE; len++) {
+    TEST_ASSERT_EQUAL_UINT8(TELEMETRY_TOO_SHORT, decodeTelemetry(buf, len, out));
+  }
+  TEST_ASSERT_EQUAL_UINT8(TELEMETRY_TOO_SHORT, decodeTelemetry(nullptr, TELEMETRY_SIZE, out));
+}
+
+static void test_header_errors(void) {
+  uint8_t buf[TELEMETRY_SIZE + 1];
+  encodeTelemetry({ 7, 1234, 56, -78 }, buf, sizeof(buf));
+  Telemetry out;
+  buf[0] ^= 1;
+  TEST_ASSERT_EQUAL_UINT8(TELEMETRY_BAD_MAGIC, decodeTelemetry(buf, TELEMETRY_SIZE, out));
+  buf[0] ^= 1;
+  buf[1] = TELEMETRY_VERSION + 0x10;
+  TEST_ASSERT_EQUAL_UINT8(TELEMETRY_BAD_VERSION, decodeTelemetry(buf, TELEMETRY_SIZE, out));
+  buf[1] = TELEMETRY_VERSION;
+  TEST_ASSERT_EQUAL_UINT8(TELEMETRY_BAD_LENGTH, decodeTelemetry(buf, TELEMETRY_SIZE + 1, out));
+}
+
+// A 1.1 packet with two extra bytes before the CRC still decodes
+static void test_newer_minor_version(void) {
+  shocknoise::XorShift32 rng(3);
+  uint8_t buf[TELEMETRY_SIZE];
+  for (int i = 0; i < ROUNDS; i++) {
+    const Telemetry in = randomTelemetry(rng);
+    encodeTelemetry(in, buf, sizeof(buf));
+    uint8_t newer[TELEMETRY_SIZE + 2];
+    memcpy(newer, buf, TELEMETRY_SIZE - 2);
+    newer[1] = TELEMETRY_VERSION | 1;
+    newer[2] = sizeof(newer);
+    newer[TELEMETRY_SIZE - 2] = 0xAA;
+    newer[TELEMETRY_SIZE - 1] = 0x55;
+    const uint16_t crc = telemetryCrc(newer, sizeof(newer) - 2);
+    newer[sizeof(newer) - 2] = (uint8_t)crc;
+    newer[sizeof(newer) - 1] = (uint8_t)(crc >> 8);
+    Telemetry out = {};
+    TEST_ASSERT_EQUAL_UINT8(TELEMETRY_OK, decodeTelemetry(newer, sizeof(newer), out));
+    TEST_ASSERT_EQUAL_UINT16(in.seq, out.seq);
+    TEST_ASSERT_EQUAL_INT16(in.motorTempDeciC, out.motorTempDeciC);
+  }
+}
+
+// Random bytes, half with a plausible header: only a CRC collision (1 in
+// 65536 of those) may get through
+static void test_garbage(void) {
+  shocknoise::XorShift32 rng(4);
+  uint8_t buf[64];
+  uint32_t accepted = 0;
+  for (int i = 0; i < ROUNDS; i++) {
+    const size_t len = rng.below(sizeof(buf));
+    for (size_t j = 0; j < len; j++) buf[j] = (uint8_t)rng.next();
+    if (len > 2 && rng.below(2)) {
+      buf[0] = TELEMETRY_MAGIC;
+      buf[1] = TELEMETRY_VERSION;
+      buf[2] = (uint8_t)len;
+    }
+    Telemetry out;
+    accepted += decodeTelemetry(buf, len, out) == TELEMETRY_OK;
+  }
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(2, accepted);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_encode_needs_room);
+  RUN_TEST(test_corruption_rejected);
+  RUN_TEST(test_truncation_rejected);
+  RUN_TEST(test_header_errors);
+  RUN_TEST(test_newer_minor_version);
+  RUN_TEST(test_garbage);
+  return UNITY_END();
+}
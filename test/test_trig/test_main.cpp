@@ -0,0 +1,92 @@
+// Q15 trig tables against libm, and the per-frame cost of screen 0's compass
+// geometry with the tables against the double-precision cos/sin it replaced.
+#include <math.h>
+#include <unity.h>
+#include <trig_utils.h>
+#include "../bench.h"
+
+static double radiansOf(double deg) { return deg * M_PI / 180.0; }
+
+void setUp(void) {}
+void tearDown(void) {}
+
+static void test_table_matches_libm(void) {
+  for (int32_t steps = -2 * trig::FULL_STEPS; steps <= 2 * trig::FULL_STEPS; steps++) {
+    const double rad = radiansOf(steps / (double)trig::STEPS_PER_DEG);
+    TEST_ASSERT_INT_WITHIN(1, lround(sin(rad) * 32768.0), trig::sinQ15Steps(steps));
+    TEST_ASSERT_INT_WITHIN(1, lround(cos(rad) * 32768.0), trig::cosQ15Steps(steps));
+  }
+}
+
+// Within a pixel of the (int) casts of the old code on every radius and angle screen 0 uses
+static void test_polar_matches_casts(void) {
+  for (int32_t r = 0; r <= 130; r++) {
+    for (int32_t deg = -720; deg <= 720; deg++) {
+      TEST_ASSERT_INT_WITHIN(1, (int)(cos(radiansOf(deg)) * r + 120), trig::polarX(120, r, deg));
+      TEST_ASSERT_INT_WITHIN(1, (int)(sin(radiansOf(deg)) * r + 120), trig::polarY(120, r, deg));
+    }
+  }
+}
+
+static void test_isqrt_is_floor_sqrt(void) {
+  for (int32_t v = 0; v < 1 << 20; v++) {
+    const int32_t r = trig::isqrt(v);
+    TEST_ASSERT_TRUE(r * r <= v && (r + 1) * (r + 1) > v);
+  }
+  TEST_ASSERT_EQUAL_INT32(46340, trig::isqrt(INT32_MAX));
+  TEST_ASSERT_EQUAL_INT32(0, trig::isqrt(-5));
+}
+
+// Compass letters, tick marks and reference needle, as updateScreen0 computes them each frame
+struct Geometry {
+  int32_t sum = 0;
+  void point(int32_t x, int32_t y) { sum += x * 3 + y; }
+};
+
+static void frameLibm(int compass, Geometry &g) {
+  static const int letters[4] = { -90, -270, 0, -180 };
+  for (int a : letters) g.point(cos(radiansOf(a - compass)) * 107 + 120, sin(radiansOf(a - compass)) * 107 + 120);
+  for (int i = 0; i < 360; i += 18) {
+    if (i % 90 == 0) continue;
+    g.point((int)(cos(radiansOf(-i - compass)) * 105 + 120), (int)(sin(radiansOf(-i - compass)) * 105 + 120));
+    g.point((int)(cos(radiansOf(-i - compass)) * 110 + 120), (int)(sin(radiansOf(-i - compass)) * 110 + 120));
+  }
+  g.point((int)(cos(radiansOf(-85)) * 81 + 120), (int)(sin(radiansOf(-85)) * 81 + 120));
+  g.point((int)(cos(radiansOf(-95)) * 81 + 120), (int)(sin(radiansOf(-95)) * 81 + 120));
+  g.point((int)(cos(radiansOf(270)) * 90 + 120), (int)(sin(radiansOf(270)) * 90 + 120));
+}
+
+static void frameTables(int compass, Geometry &g) {
+  static const int letters[4] = { -90, -270, 0, -180 };
+  for (int a : letters) g.point(trig::polarX(120, 107, a - compass), trig::polarY(120, 107, a - compass));
+  for (int i = 0; i < 360; i += 18) {
+    if (i % 90 == 0) continue;
+    g.point(trig::polarX(120, 105, -i - compass), trig::polarY(120, 105, -i - compass));
+    g.point(trig::polarX(120, 110, -i - compass), trig::polarY(120, 110, -i - compass));
+  }
+  g.point(trig::polarX(120, 81, -85), trig::polarY(120, 81, -85));
+  g.point(trig::polarX(120, 81, -95), trig::polarY(120, 81, -95));
+  g.point(trig::polarX(120, 90, 270), trig::polarY(120, 90, 270));
+}
+
+static void bench_frame_geometry(void) {
+  const int frames = 200000;
+  Geometry a, b;
+  int compass = 0;
+  const double libmUs = bench::microsPer(frames, [&] { frameLibm(compass++ % 360, a); });
+  compass = 0;
+  const double tableUs = bench::microsPer(frames, [&] { frameTables(compass++ % 360, b); });
+  bench::keep(a.sum);
+  bench::keep(b.sum);
+  bench::report("screen 0 geometry per frame: cos/sin %.3f us, Q15 tables %.3f us (%.1fx)", libmUs, tableUs,
+                libmUs / tableUs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_table_matches_libm);
+  RUN_TEST(test_polar_matches_casts);
+  RUN_TEST(test_isqrt_is_floor_sqrt);
+  RUN_TEST(bench_frame_geometry);
+  return UNITY_END();
+}
@@ -0,0 +1,353 @@
+"""Convert the 1-bpp map bitmap into fixed-size, individually compressed tiles.
+
+Reads the PROGMEM array in tools/map_source.h and writes include/map_tiles_data.h.
+Each 64x64 tile (512 bytes, MSB first, 8 bytes per row) is compressed as an
+LZ4 block, or stored raw when that would not be smaller. A tile index holds the
+offset of every tile so the firmware can decode only the tiles it shows.
+
+Besides the full-resolution map (level 0) it writes reduced levels at 1/2, 1/4
+and 1/8 scale for zoomed-out views. Each pixel of level n is the coverage of a
+2^n x 2^n box of the map, box filtered and quantised to 2 bits (MSB first, 16 bytes per tile row).
+Every level is checked before the header is written: its size, that the box
+sums still add up to the number of set map pixels, and that its tiles decode
+back to the quantised coverage.
+
+Level 1 is not stored. The firmware box filters its tiles from four level-0
+tiles when it decodes them (maptiles::decodeTile), the same way as here. Stored,
+it cost 200 KB, which put the tiled map above the raw bitmap; levels 2 and 3
+stay stored, since 2-bit coverage can't be filtered down exactly.
+
+Run it by hand:
+    python tools/map_tiles.py
+or let PlatformIO run it before every build (extra_scripts = pre:tools/map_tiles.py);
+it only regenerates when the source or this script is newer than the output.
+"""
+
+import os
+import re
+import sys
+
+TILE = 64
+RAW_FLAG = 0x80000000
+LEVELS = 4       # full resolution plus 1/2, 1/4, 1/8
+LEVEL_BPP = 2    # bits per pixel of the reduced levels
+MAX_TILES = 4096 # per level, the firmware packs the level into the top bits of a tile key
+DERIVED = (1,)   # levels the firmware computes from level 0 instead of storing
+SOURCE = os.path.join("tools", "map_source.h")
+OUTPUT = os.path.join("include", "map_tiles_data.h")
+
+
+def load_bitmap(path):
+    text = open(path).read()
+    m = re.search(r"//\s*'[^']*',\s*(\d+)x(\d+)px\s*\n\s*const unsigned char\s+(\w+)\s*\[\]", text)
+    if not m:
+        raise SystemExit("%s: no bitmap array found" % path)
+    width, height = int(m.group(1)), int(m.group(2))
+    body = text[m.end():text.index("};", m.end())]
+    data = bytes(int(v, 16) for v in re.findall(r"0x([0-9a-fA-F]{2})", body))
+    stride = (width + 7) // 8
+    if len(data) != stride * height:
+        raise SystemExit("%s: expected %d bytes, found %d" % (path, stride * height, len(data)))
+    return width, height, data
+
+
+def cut_tile(data, stride, height, tx, ty, bpp=1):
+    # tiles are byte aligned since TILE * bpp is a multiple of 8; pixels past the edge are 0
+    row_bytes = TILE * bpp // 8
+    out = bytearray()
+    for y in range(ty * TILE, ty * TILE + TILE):
+        for bx in range(tx * row_bytes, tx * row_bytes + row_bytes):
+            out.append(data[y * stride + bx] if y < height and bx < stride else 0)
+    return bytes(out)
+
+
+def unpack_bits(width, height, data):
+    """Rows of 0/1 per pixel, padded to an even width."""
+    stride = (width + 7) // 8
+    rows = []
+    for y in range(height):
+        line = data[y * stride:(y + 1) * stride]
+        row = [(line[x >> 3] >> (7 - (x & 7))) & 1 for x in range(width)]
+        if width & 1:
+            row.append(0)
+        rows.append(row)
+    return rows
+
+
+def reduce_counts(counts, width, height):
+    """Sum 2x2 boxes of a count grid. Returns the half size grid and its size."""
+    w2, h2 = (width + 1) // 2, (height + 1) // 2
+    blank = [0] * (2 * w2)
+    out = []
+    for y in range(h2):
+        r0 = counts[2 * y]
+        r1 = counts[2 * y + 1] if 2 * y + 1 < height else blank
+        row = [r0[2 * x] + r0[2 * x + 1] + r1[2 * x] + r1[2 * x + 1] for x in range(w2)]
+        if w2 & 1:
+            row.append(0)
+        out.append(row)
+    return out, w2, h2
+
+
+def quantise(count, box):
+    # rounded down, so only fully set boxes reach the top value: the map is mostly
+    # set, and a one-pixel road (clear bits) through an 8x8 box must still show
+    top = (1 << LEVEL_BPP) - 1
+    return top * count // box
+
+
+def pack_levels(values, width, bpp):
+    """Pack rows of small values MSB first. Returns the bytes and the row stride."""
+    per_byte = 8 // bpp
+    stride = (width * bpp + 7) // 8
+    out = bytearray()
+    for row in values:
+        for bx in range(stride):
+            b = 0
+            for i in range(per_byte):
+                x = bx * per_byte + i
+                v = row[x] if x < width else 0
+                b |= v << (8 - bpp * (i + 1))
+            out.append(b)
+    return bytes(out), stride
+
+
+def unpack_level(width, height, data, stride, bpp):
+    per_byte = 8 // bpp
+    mask = (1 << bpp) - 1
+    return [[(data[y * stride + x // per_byte] >> (8 - bpp * (x % per_byte + 1))) & mask
+             for x in range(width)] for y in range(height)]
+
+
+def build_levels(width, height, data):
+    """Level 0 is the map itself; level n holds 2-bit coverage of 2^n x 2^n boxes."""
+    stride = (width + 7) // 8
+    levels = [(width, height, 1, data, stride)]
+    counts = unpack_bits(width, height, data)
+    total = sum(map(sum, counts))
+    w, h = width, height
+    for n in range(1, LEVELS):
+        counts, w, h = reduce_counts(counts, w, h)
+        box = 4 ** n
+        values = [[quantise(c, box) for c in row[:w]] for row in counts]
+        packed, level_stride = pack_levels(values, w, LEVEL_BPP)
+        check_level(n, width, height, w, h, counts, total, values, packed, level_stride)
+        levels.append((w, h, LEVEL_BPP, packed, level_stride))
+        print("map_tiles: level %d %dx%d, coverage %.3f, mean value %.2f"
+              % (n, w, h, total / float(w * h * box), sum(map(sum, values)) / float(w * h)))
+    return levels
+
+
+def check_level(n, width, height, w, h, counts, total, values, packed, stride):
+    scale = 1 << n
+    if (w, h) != ((width + scale - 1) // scale, (height + scale - 1) // scale):
+        raise SystemExit("level %d: size %dx%d is wrong for a %dx%d map" % (n, w, h, width, height))
+    if sum(map(sum, counts)) != total:
+        raise SystemExit("level %d: box sums lost map pixels" % n)
+    if unpack_level(w, h, packed, stride, LEVEL_BPP) != values:
+        raise SystemExit("level %d: packed pixels do not round trip" % n)
+    if (w * LEVEL_BPP + TILE * LEVEL_BPP - 1) // (TILE * LEVEL_BPP) * ((h + TILE - 1) // TILE) > MAX_TILES:
+        raise SystemExit("level %d: too many tiles" % n)
+
+
+def lz4_block(src):
+    """Greedy LZ4 block compressor (format compatible, not tuned for ratio)."""
+    n = len(src)
+    out = bytearray()
+    table = {}
+    anchor = 0
+    i = 0
+
+    def length_bytes(v):
+        while v >= 255:
+            out.append(255)
+            v -= 255
+        out.append(v)
+
+    def sequence(lit_end, match_len, offset):
+        lit = src[anchor:lit_end]
+        token = min(len(lit), 15) << 4
+        if match_len:
+            token |= min(match_len - 4, 15)
+        out.append(token)
+        if len(lit) >= 15:
+            length_bytes(len(lit) - 15)
+        out.extend(lit)
+        if match_len:
+            out.append(offset & 0xFF)
+            out.append(offset >> 8)
+            if match_len - 4 >= 15:
+                length_bytes(match_len - 4 - 15)
+
+    # the format wants the last 5 bytes as literals and no match starting in the last 12
+    match_limit = n - 5
+    while i + 4 <= n - 12:
+        key = src[i:i + 4]
+        cand = table.get(key)
+        table[key] = i
+        if cand is not None and i - cand < 65536:
+            length = 4
+            while i + length < match_limit and src[cand + length] == src[i + length]:
+                length += 1
+            sequence(i, length, i - cand)
+            i += length
+            anchor = i
+        else:
+            i += 1
+    sequence(n, 0, 0)
+    return bytes(out)
+
+
+def lz4_unblock(src, size):
+    out = bytearray()
+    i = 0
+    while i < len(src):
+        token = src[i]
+        i += 1
+        lit = token >> 4
+        if lit == 15:
+            while True:
+                b = src[i]
+                i += 1
+                lit += b
+                if b != 255:
+                    break
+        out.extend(src[i:i + lit])
+        i += lit
+        if i >= len(src):
+            break
+        offset = src[i] | (src[i + 1] << 8)
+        i += 2
+        length = (token & 15) + 4
+        if token & 15 == 15:
+            while True:
+                b = src[i]
+                i += 1
+                length += b
+                if b != 255:
+                    break
+        for _ in range(length):
+            out.append(out[-offset])
+    if len(out) != size:
+        raise ValueError("bad block")
+    return bytes(out)
+
+
+def build_tiles(width, height, data, stride, bpp=1):
+    tiles_x = (width + TILE - 1) // TILE
+    tiles_y = (height + TILE - 1) // TILE
+    index = []
+    blob = bytearray()
+    for ty in range(tiles_y):
+        for tx in range(tiles_x):
+            raw = cut_tile(data, stride, height, tx, ty, bpp)
+            packed = lz4_block(raw)
+            if lz4_unblock(packed, len(raw)) != raw:
+                raise SystemExit("LZ4 round trip failed on tile %d,%d" % (tx, ty))
+            if len(packed) < len(raw):
+                index.append(len(blob))
+                blob.extend(packed)
+            else:
+                index.append(len(blob) | RAW_FLAG)
+                blob.extend(raw)
+    index.append(len(blob))  # end marker, so tile n's size is index[n+1] - index[n]
+    return tiles_x, tiles_y, index, bytes(blob)
+
+
+def hex_lines(data, per_line=16):
+    for i in range(0, len(data), per_line):
+        yield "\t" + ", ".join("0x%02x" % b for b in data[i:i + per_line]) + ","
+
+
+def array_name(base, n):
+    return base if n == 0 else "%s%d" % (base, n)
+
+
+def stored_size(levels):
+    return sum(len(blob) + 4 * len(index) for _, _, _, _, _, index, blob in levels)
+
+
+def write_header(path, levels, raw_size):
+    # levels: (width, height, bpp, tiles_x, tiles_y, index, blob), level 0 first;
+    # a derived level has no index or blob
+    width, height, _, tiles_x, tiles_y, _, _ = levels[0]
+    lines = [
+        "#pragma once",
+        "// Generated by tools/map_tiles.py from tools/map_source.h, do not edit.",
+        "// %dx%d map in %dx%d tiles of %dx%d px, plus %d reduced levels (%s derived from level 0): %d bytes"
+        " (raw bitmap %d bytes)."
+        % (width, height, tiles_x, tiles_y, TILE, TILE, len(levels) - 1, ", ".join(map(str, DERIVED)),
+           stored_size(levels), raw_size),
+        "#include <stdint.h>",
+        "",
+        "const uint16_t MAP_WIDTH = %d;" % width,
+        "const uint16_t MAP_HEIGHT = %d;" % height,
+        "const uint8_t MAP_TILE_SIZE = %d;" % TILE,
+        "const uint16_t MAP_TILES_X = %d;" % tiles_x,
+        "const uint16_t MAP_TILES_Y = %d;" % tiles_y,
+        "const uint32_t MAP_TILE_RAW = 0x%08X; // index flag: tile stored uncompressed" % RAW_FLAG,
+        "const uint8_t MAP_LEVELS = %d;" % len(levels),
+        "const uint8_t MAP_MAX_BPP = %d;" % max(level[2] for level in levels),
+    ]
+    for n, (w, h, bpp, lx, ly, index, blob) in enumerate(levels):
+        if n in DERIVED:
+            continue
+        lines += [
+            "",
+            "// Level %d, %dx%d px at %d bpp: offset of each tile in %s, row major, plus an end marker"
+            % (n, w, h, bpp, array_name("mapTileData", n)),
+            "const uint32_t %s[] PROGMEM = {" % array_name("mapTileIndex", n),
+        ]
+        for i in range(0, len(index), 8):
+            lines.append("\t" + ", ".join("0x%08X" % v for v in index[i:i + 8]) + ",")
+        lines += ["};", "", "const uint8_t %s[] PROGMEM = {" % array_name("mapTileData", n)]
+        lines += hex_lines(blob)
+        lines.append("};")
+    lines += [
+        "",
+        "// Every level of the map, level n is scaled down by 2^n",
+        "struct MapLevel {",
+        "\tuint16_t width, height;",
+        "\tuint16_t tilesX, tilesY;",
+        "\tuint8_t bpp;",
+        "\tconst uint32_t *index; // null for a level derived from level 0",
+        "\tconst uint8_t *data;",
+        "};",
+        "",
+        "const MapLevel mapLevels[MAP_LEVELS] = {",
+    ]
+    for n, (w, h, bpp, lx, ly, _, _) in enumerate(levels):
+        stored = n not in DERIVED
+        lines.append("\t{ %d, %d, %d, %d, %d, %s, %s }," % (
+            w, h, lx, ly, bpp, array_name("mapTileIndex", n) if stored else "nullptr",
+            array_name("mapTileData", n) if stored else "nullptr"))
+    lines += ["};", ""]
+    with open(path, "w") as f:
+        f.write("\n".join(lines))
+
+
+def generate(project_dir):
+    src = os.path.join(project_dir, SOURCE)
+    dst = os.path.join(project_dir, OUTPUT)
+    inputs = [src, os.path.abspath(__file__) if "__file__" in globals() else src]
+    if os.path.exists(dst) and all(os.path.getmtime(dst) >= os.path.getmtime(p) for p in inputs):
+        return False
+    width, height, data = load_bitmap(src)
+    levels = []
+    for n, (w, h, bpp, level_data, stride) in enumerate(build_levels(width, height, data)):
+        if n in DERIVED:
+            levels.append((w, h, bpp, (w + TILE - 1) // TILE, (h + TILE - 1) // TILE, [], b""))
+            continue
+        tiles_x, tiles_y, index, blob = build_tiles(w, h, level_data, stride, bpp)
+        levels.append((w, h, bpp, tiles_x, tiles_y, index, blob))
+    write_header(dst, levels, len(data))
+    print("map_tiles: %d levels, %d -> %d bytes" % (len(levels), len(data), stored_size(levels)))
+    return True
+
+
+if "Import" in globals():
+    # running as a PlatformIO extra script
+    Import("env")  # noqa: F821
+    generate(env.subst("$PROJECT_DIR"))  # noqa: F821
+elif __name__ == "__main__":
+    generate(os.path.dirname(os.path.dirname(os.path.abspath(sys.argv[0]))))